@@ -0,0 +1,123 @@
+#pragma once
+
+#include <util/util.h>
+
+#include <chrono>
+
+class Stopwatch {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+public:
+    f64 seconds() const {
+        return std::chrono::duration<f64>(std::chrono::steady_clock::now() - start).count();
+    }
+};
+
+// Keeps the compiler from dropping a result it can prove is never read.
+template <typename T>
+void keep(const T &value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+class HardwareCounters {
+public:
+    bool valid = false;
+
+    f64 instructions = 0;
+    f64 branchMisses = 0;
+    f64 cacheMisses = 0;
+};
+
+// perf_event_open counters for the calling thread, valid() is false where the kernel refuses them.
+class PerfCounters {
+    int group = -1;
+    int branches = -1;
+    int caches = -1;
+
+public:
+    bool valid() const { return group >= 0; }
+
+    void start();
+    // totals since start divided by operations
+    HardwareCounters stop(u64 operations);
+
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+};
+
+class Measurement {
+public:
+    std::string name;
+    u64 operations = 0; // per sample
+    u32 samples = 0;
+
+    // nanoseconds per operation
+    f64 mean = 0;
+    f64 min = 0;
+    f64 p50 = 0;
+    f64 p90 = 0;
+    f64 p99 = 0;
+
+    HardwareCounters counters;
+};
+
+class BenchSettings {
+public:
+    u32 samples = 100;
+    bool perf = false;
+
+    // only benchmarks whose name contains this run
+    std::string filter;
+    std::string json;
+};
+
+// Runs each body once to warm up and then once per sample, every call performing operations units of work.
+class Suite {
+    BenchSettings settings;
+    PerfCounters perf;
+
+    std::vector<Measurement> results;
+
+    void record(const std::string &name, u64 operations, std::vector<f64> &times, const HardwareCounters &counters);
+
+public:
+    template <typename Body>
+    void measure(const std::string &name, u64 operations, Body body) {
+        if (name.find(settings.filter) == std::string::npos)
+            return;
+
+        body();
+
+        std::vector<f64> times(settings.samples);
+        HardwareCounters counters;
+
+        for (f64 &time : times) {
+            if (settings.perf)
+                perf.start();
+
+            Stopwatch watch;
+            body();
+            time = watch.seconds();
+
+            // counters come from the last sample, the timing percentiles cover the spread
+            if (settings.perf)
+                counters = perf.stop(operations);
+        }
+
+        record(name, operations, times, counters);
+    }
+
+    // writes settings.json if it was given
+    bool write() const;
+
+    explicit Suite(BenchSettings settings);
+};
+
+void benchDelaySlots(Suite &suite);
+void benchDispatch(Suite &suite);
+void benchMemory(Suite &suite);
+void benchStep(Suite &suite);
+void benchPrimitives(Suite &suite);
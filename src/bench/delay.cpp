@@ -0,0 +1,82 @@
+#include "bench.h"
+
+#include <queue>
+#include <functional>
+
+// A four instruction loop body ending in a taken branch, dispatched the way Cpu::exec does it.
+// Slots is either the old std::queue of closures or the pending target state Cpu uses now.
+
+class QueueSlots {
+    std::queue<std::function<void()>> slots;
+
+public:
+    u64 pc = 0;
+
+    bool pending() const { return !slots.empty(); }
+    void apply() {
+        slots.front()();
+        slots.pop();
+    }
+
+    void branch(i16 value) {
+        slots.push([this, value]() {
+            pc += (value - 1) * sizeof(u32);
+        });
+    }
+};
+
+class StateSlots {
+    bool hasTarget = false;
+    u64 target = 0;
+
+public:
+    u64 pc = 0;
+
+    bool pending() const { return hasTarget; }
+    void apply() {
+        hasTarget = false;
+        pc = target;
+    }
+
+    void branch(i16 value) {
+        hasTarget = true;
+        target = pc + (value + 1) * sizeof(u32);
+    }
+};
+
+template <typename Slots>
+u64 runLoop(u64 iterations) {
+    Slots core;
+    u64 counter = iterations;
+    u64 accumulator = 0;
+    u64 executed = 0;
+
+    while (counter) {
+        bool hasSlot = core.pending();
+
+        switch ((core.pc / sizeof(u32)) % 4) {
+            case 0: accumulator += counter; break;
+            case 1: accumulator ^= accumulator << 3; break;
+            case 2: if (--counter) core.branch(-3); break;
+            case 3: accumulator++; break; // delay slot
+            default: break;
+        }
+
+        core.pc += sizeof(u32);
+        executed++;
+
+        if (hasSlot)
+            core.apply();
+    }
+
+    // keep the loop from being optimized away
+    return executed + (accumulator & 1);
+}
+
+void benchDelaySlots(Suite &suite) {
+    // four instructions per iteration, a taken branch every 4
+    constexpr u64 iterations = 1000000;
+
+    suite.measure("delay/queue", 4 * iterations, []() { keep(runLoop<QueueSlots>(iterations)); });
+    suite.measure("delay/state", 4 * iterations, []() { keep(runLoop<StateSlots>(iterations)); });
+}
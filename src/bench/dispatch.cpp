@@ -0,0 +1,233 @@
+#include "bench.h"
+
+#include <vector>
+
+// Decoding a mixed stream of instruction words, the way Cpu::lookup used to (nested switches)
+// against the way it does now (one constexpr table, one load for the route and one for the handler).
+// lookup/* only finds the handler, dispatch/* also calls it. The indirect call mispredicts on a
+// mixed stream and costs about as much as either lookup, so dispatch/* ends up close.
+
+class Counters {
+public:
+    u64 alu = 0;
+    u64 immediate = 0;
+    u64 flow = 0;
+    u64 data = 0;
+    u64 cop0 = 0;
+    u64 reserved = 0;
+};
+
+typedef void (*Handler)(Counters &counters);
+
+void countAlu(Counters &counters) { counters.alu++; }
+void countImmediate(Counters &counters) { counters.immediate++; }
+void countFlow(Counters &counters) { counters.flow++; }
+void countData(Counters &counters) { counters.data++; }
+void countCop0(Counters &counters) { counters.cop0++; }
+void countReserved(Counters &counters) { counters.reserved++; }
+
+Handler lookupSwitch(u32 instruction) {
+    u32 op = shift(instruction, 26, 6);
+
+    switch (op) {
+        case 0b000000: {
+            u32 func = shift(instruction, 0, 6);
+            switch (func) {
+                case 0b100000: case 0b100001: case 0b100010: case 0b100011:
+                case 0b011000: case 0b011001: case 0b011010: case 0b011011:
+                case 0b010000: case 0b010001: case 0b010010: case 0b010011:
+                case 0b000000: case 0b000010: case 0b000011: case 0b000100:
+                case 0b000110: case 0b000111: case 0b101010: case 0b101011:
+                case 0b100100: case 0b100101: case 0b100110: case 0b100111:
+                case 0b001100: case 0b001101:
+                    return countAlu;
+                case 0b001000: case 0b001001:
+                    return countFlow;
+                default: break;
+            }
+            break;
+        }
+
+        case 0b001000: case 0b001001: case 0b001010: case 0b001011:
+        case 0b001100: case 0b001101: case 0b001110: case 0b001111:
+            return countImmediate;
+
+        case 0b000100: case 0b000101: case 0b000110: case 0b000111:
+        case 0b010100: case 0b010101: case 0b010110: case 0b010111:
+        case 0b000010: case 0b000011: case 0b101111:
+            return countFlow;
+
+        case 0b100000: case 0b100001: case 0b100010: case 0b100011:
+        case 0b100100: case 0b100101: case 0b100110: case 0b101000:
+        case 0b101001: case 0b101010: case 0b101011: case 0b101110:
+            return countData;
+
+        case 0b000001: {
+            u32 func = shift(instruction, 16, 5);
+            switch (func) {
+                case 0b00000: case 0b00001: case 0b10000: case 0b10001:
+                    return countFlow;
+                default: break;
+            }
+            break;
+        }
+
+        case 0b010000: {
+            u32 func = shift(instruction, 21, 5);
+            switch (func) {
+                case 0b00000: case 0b00100:
+                    return countCop0;
+                default: break;
+            }
+            break;
+        }
+
+        default: break;
+    }
+
+    return countReserved;
+}
+
+class Table {
+public:
+    static constexpr u32 entries = 64;
+
+    // same packing as DispatchTable::routes: level base << 16 | field mask << 8 | field shift
+    u32 routes[entries] = {};
+
+    Handler handlers[4 * entries] = {};
+
+    constexpr void route(u32 op, u32 level, u32 offset, u32 bits) {
+        routes[op] = (level * entries) << 16 | ((1u << bits) - 1) << 8 | offset;
+    }
+};
+
+constexpr Table makeTable() {
+    Table table;
+
+    for (u32 a = 0; a < 4 * Table::entries; a++)
+        table.handlers[a] = countReserved;
+
+    for (u32 a = 0; a < Table::entries; a++)
+        table.route(a, 0, 26, 6);
+
+    table.route(0b000000, 1, 0, 6);
+    table.route(0b000001, 2, 16, 5);
+    table.route(0b010000, 3, 21, 5);
+
+    Handler *primary = table.handlers;
+    Handler *special = table.handlers + Table::entries;
+    Handler *regimm = table.handlers + 2 * Table::entries;
+    Handler *cop0 = table.handlers + 3 * Table::entries;
+
+    const u8 alu[] = {
+        0b100000, 0b100001, 0b100010, 0b100011, 0b011000, 0b011001, 0b011010, 0b011011,
+        0b010000, 0b010001, 0b010010, 0b010011, 0b000000, 0b000010, 0b000011, 0b000100,
+        0b000110, 0b000111, 0b101010, 0b101011, 0b100100, 0b100101, 0b100110, 0b100111,
+        0b001100, 0b001101,
+    };
+    for (u8 func : alu)
+        special[func] = countAlu;
+
+    special[0b001000] = countFlow;
+    special[0b001001] = countFlow;
+
+    for (u32 op = 0b001000; op <= 0b001111; op++)
+        primary[op] = countImmediate;
+
+    const u8 flow[] = {
+        0b000100, 0b000101, 0b000110, 0b000111, 0b010100, 0b010101, 0b010110, 0b010111,
+        0b000010, 0b000011, 0b101111,
+    };
+    for (u8 op : flow)
+        primary[op] = countFlow;
+
+    const u8 data[] = {
+        0b100000, 0b100001, 0b100010, 0b100011, 0b100100, 0b100101, 0b100110, 0b101000,
+        0b101001, 0b101010, 0b101011, 0b101110,
+    };
+    for (u8 op : data)
+        primary[op] = countData;
+
+    regimm[0b00000] = countFlow;
+    regimm[0b00001] = countFlow;
+    regimm[0b10000] = countFlow;
+    regimm[0b10001] = countFlow;
+
+    cop0[0b00000] = countCop0;
+    cop0[0b00100] = countCop0;
+
+    return table;
+}
+
+Handler lookupTable(u32 instruction) {
+    static constexpr Table table = makeTable();
+
+    u32 route = table.routes[instruction >> 26];
+
+    return table.handlers[(route >> 16) + ((instruction >> (route & 0xFF)) & ((route >> 8) & 0xFF))];
+}
+
+// Roughly the mix of a compiled game loop: mostly immediates, loads/stores and SPECIAL alu ops.
+std::vector<u32> makeStream(u64 size) {
+    const u32 samples[] = {
+        0x24420001, // addiu v0, v0, 1
+        0x3c088000, // lui t0, 0x8000
+        0x35080010, // ori t0, t0, 0x10
+        0x8d090000, // lw t1, 0(t0)
+        0xad090004, // sw t1, 4(t0)
+        0x00851021, // addu v0, a0, a1
+        0x00021080, // sll v0, v0, 2
+        0x00a4182a, // slt v1, a1, a0
+        0x1440fffc, // bne v0, zero, -4
+        0x04400002, // bltz v0, 2
+        0x03e00008, // jr ra
+        0x0c000100, // jal 0x400
+        0x40086000, // mfc0 t0, $12
+        0x90a20000, // lbu v0, 0(a1)
+        0x7c000000, // reserved
+    };
+
+    std::vector<u32> stream(size);
+
+    // fixed xorshift so both runs see the same words
+    u32 state = 0x9e3779b9;
+    for (u32 &word : stream) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+
+        word = samples[state % (sizeof(samples) / sizeof(samples[0]))];
+    }
+
+    return stream;
+}
+
+template <Handler (*Lookup)(u32)>
+u64 runStream(const std::vector<u32> &stream) {
+    Counters counters;
+
+    for (u32 word : stream)
+        Lookup(word)(counters);
+
+    return counters.alu + counters.immediate + counters.flow + counters.data + counters.cop0 + counters.reserved;
+}
+
+template <Handler (*Lookup)(u32)>
+u64 lookupStream(const std::vector<u32> &stream) {
+    u64 sum = 0;
+
+    for (u32 word : stream)
+        sum += reinterpret_cast<u64>(Lookup(word));
+
+    return sum;
+}
+
+void benchDispatch(Suite &suite) {
+    std::vector<u32> stream = makeStream(1 << 16);
+
+    suite.measure("lookup/switch", stream.size(), [&stream]() { keep(lookupStream<lookupSwitch>(stream)); });
+    suite.measure("lookup/table", stream.size(), [&stream]() { keep(lookupStream<lookupTable>(stream)); });
+    suite.measure("dispatch/switch", stream.size(), [&stream]() { keep(runStream<lookupSwitch>(stream)); });
+    suite.measure("dispatch/table", stream.size(), [&stream]() { keep(runStream<lookupTable>(stream)); });
+}
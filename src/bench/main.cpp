@@ -0,0 +1,37 @@
+#include "bench.h"
+
+#include <fmt/printf.h>
+
+#include <algorithm>
+#include <cstdlib>
+
+int main(int count, char **args) {
+    BenchSettings settings;
+
+    for (i32 a = 1; a < count; a++) {
+        const char *arg = args[a];
+
+        if (strcmp(arg, "--perf") == 0) {
+            settings.perf = true;
+        } else if (strcmp(arg, "--json") == 0 && a + 1 < count) {
+            settings.json = args[++a];
+        } else if (strcmp(arg, "--filter") == 0 && a + 1 < count) {
+            settings.filter = args[++a];
+        } else if (strcmp(arg, "--samples") == 0 && a + 1 < count) {
+            settings.samples = std::max(1, std::atoi(args[++a]));
+        } else {
+            fmt::print("Usage: scout_bench [--perf] [--json <path>] [--filter <name>] [--samples <count>]\n");
+            return -1;
+        }
+    }
+
+    Suite suite(settings);
+
+    benchDelaySlots(suite);
+    benchDispatch(suite);
+    benchMemory(suite);
+    benchStep(suite);
+    benchPrimitives(suite);
+
+    return suite.write() ? 0 : -1;
+}
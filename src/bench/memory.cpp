@@ -0,0 +1,73 @@
+#include "bench.h"
+
+#include <cpu/memory.h>
+
+#include <fmt/format.h>
+
+// Every access pattern walks a 4 KiB window so the page lookup stays hot and the region decides the cost.
+
+static constexpr u64 accesses = 4096;
+
+static std::vector<u8> blankImage() {
+    return std::vector<u8>(sizeof(Header));
+}
+
+void benchMemory(Suite &suite) {
+    Rom rom(blankImage());
+    Memory memory(rom);
+
+    struct Target {
+        const char *name;
+        u32 base;
+    };
+
+    const Target targets[] = {
+        { "ram", 0x00100000 },
+        { "kseg0", 0x80100000 },
+        { "kseg1", 0xA0100000 },
+        { "mi", 0xA4300000 }, // register block, 16 bytes wide
+        { "cart", 0xB0000000 }, // read only image
+    };
+
+    for (const Target &target : targets) {
+        // register blocks are smaller than the window, wrap inside them
+        u32 mask = target.base == 0xA4300000 ? 0xF : 0xFFF;
+        u32 base = target.base;
+
+        suite.measure(fmt::format("memory/getByte/{}", target.name), accesses, [&memory, base, mask]() {
+            u32 sum = 0;
+
+            for (u32 a = 0; a < accesses; a++)
+                sum += memory.getByte(base + (a & mask));
+
+            keep(sum);
+        });
+
+        suite.measure(fmt::format("memory/get<u32>/{}", target.name), accesses, [&memory, base, mask]() {
+            u32 sum = 0;
+
+            for (u32 a = 0; a < accesses; a++)
+                sum += memory.get<u32>(base + ((a * sizeof(u32)) & mask));
+
+            keep(sum);
+        });
+
+        if (target.base == 0xB0000000)
+            continue;
+
+        suite.measure(fmt::format("memory/set<u32>/{}", target.name), accesses, [&memory, base, mask]() {
+            for (u32 a = 0; a < accesses; a++)
+                memory.set<u32>(base + ((a * sizeof(u32)) & mask), a);
+        });
+    }
+
+    // straddles the end of a page, forcing the byte by byte path
+    suite.measure("memory/get<u32>/split", accesses, [&memory]() {
+        u32 sum = 0;
+
+        for (u32 a = 0; a < accesses; a++)
+            sum += memory.get<u32>(0x80100FFE);
+
+        keep(sum);
+    });
+}
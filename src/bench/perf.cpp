@@ -0,0 +1,76 @@
+#include "bench.h"
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static int openCounter(u32 type, u64 config, int group) {
+    perf_event_attr attributes = {};
+    attributes.type = type;
+    attributes.size = sizeof(attributes);
+    attributes.config = config;
+    attributes.disabled = group < 0;
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+
+    return static_cast<int>(syscall(__NR_perf_event_open, &attributes, 0, -1, group, 0));
+}
+
+static u64 readCounter(int fd) {
+    u64 value = 0;
+
+    if (fd < 0 || ::read(fd, &value, sizeof(value)) != sizeof(value))
+        return 0;
+
+    return value;
+}
+
+void PerfCounters::start() {
+    if (!valid())
+        return;
+
+    ioctl(group, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(group, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+HardwareCounters PerfCounters::stop(u64 operations) {
+    HardwareCounters counters;
+
+    if (!valid())
+        return counters;
+
+    ioctl(group, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+    counters.valid = true;
+    counters.instructions = static_cast<f64>(readCounter(group)) / operations;
+    counters.branchMisses = static_cast<f64>(readCounter(branches)) / operations;
+    counters.cacheMisses = static_cast<f64>(readCounter(caches)) / operations;
+
+    return counters;
+}
+
+PerfCounters::PerfCounters() {
+    group = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, -1);
+
+    if (group < 0)
+        return;
+
+    branches = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, group);
+    caches = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, group);
+}
+
+PerfCounters::~PerfCounters() {
+    for (int fd : { caches, branches, group }) {
+        if (fd >= 0)
+            close(fd);
+    }
+}
+#else
+void PerfCounters::start() { }
+HardwareCounters PerfCounters::stop(u64) { return HardwareCounters(); }
+
+PerfCounters::PerfCounters() = default;
+PerfCounters::~PerfCounters() = default;
+#endif
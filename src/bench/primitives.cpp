@@ -0,0 +1,63 @@
+#include "bench.h"
+
+#include <rom/rom.h>
+
+// The helpers in util.h and rom.h that sit under every memory access and ROM conversion.
+
+static constexpr u64 values = 4096;
+
+template <typename T>
+static void benchSwap(Suite &suite, const char *name) {
+    suite.measure(name, values, []() {
+        T sum = 0;
+
+        for (u64 a = 0; a < values; a++) {
+            T value = static_cast<T>(a * 0x9E3779B97F4A7C15ull);
+            keep(value);
+
+            sum += swap(value);
+        }
+
+        keep(sum);
+    });
+}
+
+void benchPrimitives(Suite &suite) {
+    benchSwap<u16>(suite, "util/swap<u16>");
+    benchSwap<u32>(suite, "util/swap<u32>");
+    benchSwap<u64>(suite, "util/swap<u64>");
+
+    suite.measure("util/shift<u32>", values, []() {
+        u32 sum = 0;
+
+        for (u32 a = 0; a < values; a++) {
+            u32 word = a * 0x9E3779B9u;
+            keep(word);
+
+            sum += shift(word, 26, 6) + shift(word, 21, 5) + shift(word, 0, 16);
+        }
+
+        keep(sum);
+    });
+
+    std::vector<u8> image(mb(1));
+    for (ssi a = 0; a < image.size(); a++)
+        image[a] = static_cast<u8>(a);
+
+    std::vector<u8> output(image.size());
+
+    suite.measure("rom/swapBytes/2", image.size(), [&image, &output]() {
+        swapBytes(2, image.data(), output.data(), image.size());
+        keep(output.data());
+    });
+
+    suite.measure("rom/swapBytes/4", image.size(), [&image, &output]() {
+        swapBytes(4, image.data(), output.data(), image.size());
+        keep(output.data());
+    });
+
+    suite.measure("rom/swapBytes/4/in-place", image.size(), [&image]() {
+        swapBytes(4, image.data(), image.data(), image.size());
+        keep(image.data());
+    });
+}
@@ -0,0 +1,55 @@
+#include "bench.h"
+
+#include <cpu/cpu.h>
+
+#include <fmt/format.h>
+
+// Cpu::step over a bootstrap filled with one opcode, closed by a jump back to the entry point.
+
+static constexpr u32 bootstrapOffset = 0x40;
+static constexpr u32 repeats = 1000;
+
+static std::vector<u8> repeatImage(u32 word) {
+    std::vector<u8> image(sizeof(Header));
+
+    auto put = [&image](u32 index, u32 value) {
+        value = swap(value);
+        std::memcpy(&image[bootstrapOffset + index * sizeof(u32)], &value, sizeof(u32));
+    };
+
+    for (u32 a = 0; a < repeats; a++)
+        put(a, word);
+
+    put(repeats, 0x08000000 | ((0xA4000040 >> 2) & 0x03FFFFFF)); // j 0xA4000040
+    put(repeats + 1, 0); // nop
+
+    return image;
+}
+
+void benchStep(Suite &suite) {
+    struct Opcode {
+        const char *name;
+        u32 word;
+    };
+
+    const Opcode opcodes[] = {
+        { "addu", 0x00851021 }, // addu v0, a0, a1
+        { "sll", 0x00021080 }, // sll v0, v0, 2
+        { "addiu", 0x24420001 }, // addiu v0, v0, 1
+        { "lui", 0x3C088000 }, // lui t0, 0x8000
+        { "lw", 0x8C090100 }, // lw t1, 0x100(zero)
+        { "sw", 0xAC090100 }, // sw t1, 0x100(zero)
+        { "bne", 0x14000000 }, // bne zero, zero, never taken
+        { "mfc0", 0x40084800 }, // mfc0 t0, Count
+    };
+
+    for (const Opcode &opcode : opcodes) {
+        Rom rom(repeatImage(opcode.word));
+        Cpu cpu(rom, CpuSettings());
+
+        suite.measure(fmt::format("step/{}", opcode.name), repeats + 2, [&cpu]() {
+            for (u32 a = 0; a < repeats + 2; a++)
+                cpu.step();
+        });
+    }
+}
@@ -0,0 +1,89 @@
+#include "bench.h"
+
+#include <fmt/printf.h>
+
+#include <algorithm>
+#include <cstdio>
+
+static f64 percentile(const std::vector<f64> &sorted, f64 fraction) {
+    ssi index = static_cast<ssi>(fraction * (sorted.size() - 1) + 0.5);
+
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+void Suite::record(const std::string &name, u64 operations, std::vector<f64> &times, const HardwareCounters &counters) {
+    for (f64 &time : times)
+        time = time * 1e9 / operations;
+
+    std::sort(times.begin(), times.end());
+
+    Measurement result;
+    result.name = name;
+    result.operations = operations;
+    result.samples = times.size();
+
+    for (f64 time : times)
+        result.mean += time;
+
+    result.mean /= times.size();
+    result.min = times.front();
+    result.p50 = percentile(times, 0.5);
+    result.p90 = percentile(times, 0.9);
+    result.p99 = percentile(times, 0.99);
+    result.counters = counters;
+
+    fmt::print("{:<32} {:>9.3f} ns mean {:>9.3f} p50 {:>9.3f} p90 {:>9.3f} p99",
+        name, result.mean, result.p50, result.p90, result.p99);
+
+    if (counters.valid) {
+        fmt::print(" {:>8.2f} instr {:>7.4f} br-miss {:>7.4f} cache-miss",
+            counters.instructions, counters.branchMisses, counters.cacheMisses);
+    }
+
+    fmt::print("\n");
+
+    results.push_back(std::move(result));
+}
+
+bool Suite::write() const {
+    if (settings.json.empty())
+        return true;
+
+    std::FILE *file = std::fopen(settings.json.c_str(), "w");
+
+    if (!file) {
+        fmt::print("Could not open {} for writing.\n", settings.json);
+        return false;
+    }
+
+    fmt::print(file, "{{\n  \"unit\": \"ns/op\",\n  \"results\": [\n");
+
+    for (ssi a = 0; a < results.size(); a++) {
+        const Measurement &result = results[a];
+
+        // names are plain identifiers and slashes, nothing to escape
+        fmt::print(file, "    {{\"name\": \"{}\", \"operations\": {}, \"samples\": {}, "
+            "\"mean\": {:.4f}, \"min\": {:.4f}, \"p50\": {:.4f}, \"p90\": {:.4f}, \"p99\": {:.4f}",
+            result.name, result.operations, result.samples,
+            result.mean, result.min, result.p50, result.p90, result.p99);
+
+        if (result.counters.valid) {
+            fmt::print(file, ", \"instructions\": {:.4f}, \"branchMisses\": {:.4f}, \"cacheMisses\": {:.4f}",
+                result.counters.instructions, result.counters.branchMisses, result.counters.cacheMisses);
+        }
+
+        fmt::print(file, "}}{}\n", a + 1 < results.size() ? "," : "");
+    }
+
+    fmt::print(file, "  ]\n}}\n");
+    std::fclose(file);
+
+    return true;
+}
+
+Suite::Suite(BenchSettings settings) : settings(std::move(settings)) {
+    if (this->settings.perf && !perf.valid()) {
+        fmt::print("Hardware counters are unavailable, continuing without them.\n");
+        this->settings.perf = false;
+    }
+}
@@ -0,0 +1,93 @@
+#include <cpu/block.h>
+
+#include <algorithm>
+
+Block *BlockCache::find(u32 start) {
+    auto iterator = blocks.find(start);
+
+    return iterator == blocks.end() ? nullptr : iterator->second.get();
+}
+
+Block &BlockCache::insert(std::unique_ptr<Block> block) {
+    Block &result = *block;
+
+    for (u32 page = result.firstPage(); page <= result.lastPage(); page++)
+        pages[page].push_back(&result);
+
+    blocks[result.start] = std::move(block);
+    stats.compiled++;
+
+    return result;
+}
+
+void BlockCache::link(Block &from, Block &to, u64 pc) {
+    BlockLink *target = nullptr;
+
+    // take a stale or empty slot if there is one, otherwise push out the older link
+    for (BlockLink &link : from.links) {
+        if (!link.block || link.epoch != epoch) {
+            target = &link;
+            break;
+        }
+    }
+
+    if (!target) {
+        from.links[1] = from.links[0];
+        target = &from.links[0];
+    }
+
+    target->block = &to;
+    target->pc = pc;
+    target->epoch = epoch;
+}
+
+Block *BlockCache::follow(const Block &from, u64 pc) const {
+    for (const BlockLink &link : from.links) {
+        if (link.block && link.pc == pc && link.epoch == epoch)
+            return link.block;
+    }
+
+    return nullptr;
+}
+
+void BlockCache::invalidate(u32 page) {
+    auto iterator = pages.find(page);
+
+    if (iterator == pages.end())
+        return;
+
+    std::vector<Block *> invalid = std::move(iterator->second);
+    pages.erase(iterator);
+
+    for (Block *block : invalid) {
+        if (!block->valid)
+            continue;
+
+        block->valid = false;
+        stats.invalidated++;
+
+        // drop it from the other page it spans
+        for (u32 other = block->firstPage(); other <= block->lastPage(); other++) {
+            auto list = pages.find(other);
+            if (list == pages.end())
+                continue;
+
+            list->second.erase(std::remove(list->second.begin(), list->second.end(), block), list->second.end());
+        }
+
+        auto owner = blocks.find(block->start);
+        retired.push_back(std::move(owner->second));
+        blocks.erase(owner);
+    }
+
+    epoch++;
+}
+
+void BlockCache::collect() {
+    retired.clear();
+}
+
+void BlockCache::dropCode() {
+    for (auto &entry : blocks)
+        entry.second->code = nullptr;
+}
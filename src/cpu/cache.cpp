@@ -0,0 +1,23 @@
+#include <cpu/cache.h>
+
+CachePage &InstructionCache::create(u32 page) {
+    assert(page < pages.size());
+
+    std::unique_ptr<CachePage> &entry = pages[page];
+
+    if (!entry)
+        entry = std::make_unique<CachePage>();
+
+    return *entry;
+}
+
+void InstructionCache::invalidate(u32 page) {
+    CachePage *entry = find(page);
+
+    // entries might still be executing, they are cleared lazily on the next fetch
+    if (entry)
+        entry->stale = true;
+}
+
+// physical memory ends where the KSEG0 mirror begins
+InstructionCache::InstructionCache() : pages(0x20000000 >> Memory::pageBits) { }
@@ -9,54 +9,61 @@
 #define REGVAL(index) REGFMT(index, "{}")
 #define REGBRANCH(value) \
     fmt::format(hex, registers.pc + value * sizeof(u32))
-#define DISASM(name, text, ...) \
-    fmt::print("[0x{:0>8X}] 0x{:0>8X}: {} {}\n", registers.pc, instruction, name, fmt::format(text, __VA_ARGS__))
 
-//#undef DISASM
-//#define DISASM(...)
+#ifdef SCOUT_TRACE
+#define DISASM(name, text, ...) \
+    do { \
+        if (trace.enabled(registers.pc, instruction.word)) { \
+            trace.write("[0x{:0>8X}] 0x{:0>8X}: {} ", registers.pc, instruction.word, name); \
+            trace.write(text "\n", __VA_ARGS__); \
+        } \
+    } while (false)
+#else
+#define DISASM(...) do { } while (false)
+#endif
 
 const char *hex = "0x{:0>8X}";
 const char *bin = "0b{:0>32b}";
 
-void Cpu::opAdd(u32 instruction) {
-    u8 a = shift(instruction, 21, 5);
-    u8 b = shift(instruction, 16, 5);
-    u8 dest = shift(instruction, 11, 5);
+void Cpu::opAdd(const Instruction &instruction) {
+    u8 a = instruction.rs;
+    u8 b = instruction.rt;
+    u8 dest = instruction.rd;
 
     DISASM("add", "{}, {} + {}", REGNAME(dest), REGVAL(a), REGVAL(b));
 
     registers.regs[dest] = registers.regs[a] + registers.regs[b];
 }
-void Cpu::opAddu(u32 instruction) {
-    u8 a = shift(instruction, 21, 5);
-    u8 b = shift(instruction, 16, 5);
-    u8 dest = shift(instruction, 11, 5);
+void Cpu::opAddu(const Instruction &instruction) {
+    u8 a = instruction.rs;
+    u8 b = instruction.rt;
+    u8 dest = instruction.rd;
 
     DISASM("addu", "{}, {} + {}", REGNAME(dest), REGVAL(a), REGVAL(b));
 
     registers.regs[dest] = registers.regs[a] + registers.regs[b];
 }
-void Cpu::opSub(u32 instruction) {
-    u8 a = shift(instruction, 21, 5);
-    u8 b = shift(instruction, 16, 5);
-    u8 dest = shift(instruction, 11, 5);
+void Cpu::opSub(const Instruction &instruction) {
+    u8 a = instruction.rs;
+    u8 b = instruction.rt;
+    u8 dest = instruction.rd;
 
     DISASM("sub", "{}, {} - {}", REGNAME(dest), REGVAL(a), REGVAL(b));
 
     registers.regs[dest] = registers.regs[a] - registers.regs[b];
 }
-void Cpu::opSubu(u32 instruction) {
-    u8 a = shift(instruction, 21, 5);
-    u8 b = shift(instruction, 16, 5);
-    u8 dest = shift(instruction, 11, 5);
+void Cpu::opSubu(const Instruction &instruction) {
+    u8 a = instruction.rs;
+    u8 b = instruction.rt;
+    u8 dest = instruction.rd;
 
     DISASM("subu", "{}, {} - {}", REGNAME(dest), REGVAL(a), REGVAL(b));
 
     registers.regs[dest] = registers.regs[a] - registers.regs[b];
 }
-void Cpu::opMult(u32 instruction) {
-    u8 a = shift(instruction, 21, 5);
-    u8 b = shift(instruction, 16, 5);
+void Cpu::opMult(const Instruction &instruction) {
+    u8 a = instruction.rs;
+    u8 b = instruction.rt;
 
     DISASM("mult", "{} * {}", REGVAL(a), REGVAL(b));
 
@@ -64,9 +71,9 @@ void Cpu::opMult(u32 instruction) {
     registers.lo = shift(result, 0, 32);
     registers.hi = shift(result, 32, 32);
 }
-void Cpu::opMultu(u32 instruction) {
-    u8 a = shift(instruction, 21, 5);
-    u8 b = shift(instruction, 16, 5);
+void Cpu::opMultu(const Instruction &instruction) {
+    u8 a = instruction.rs;
+    u8 b = instruction.rt;
 
     DISASM("multu", "{} * {}", REGVAL(a), REGVAL(b));
 
@@ -74,9 +81,9 @@ void Cpu::opMultu(u32 instruction) {
     registers.lo = shift(result, 0, 32);
     registers.hi = shift(result, 32, 32);
 }
-void Cpu::opDiv(u32 instruction) {
-    u8 a = shift(instruction, 21, 5);
-    u8 b = shift(instruction, 16, 5);
+void Cpu::opDiv(const Instruction &instruction) {
+    u8 a = instruction.rs;
+    u8 b = instruction.rt;
 
     DISASM("div", "{} / {}", REGVAL(a), REGVAL(b));
 
@@ -85,9 +92,9 @@ void Cpu::opDiv(u32 instruction) {
     registers.lo = result;
     registers.hi = remainder;
 }
-void Cpu::opDivu(u32 instruction) {
-    u8 a = shift(instruction, 21, 5);
-    u8 b = shift(instruction, 16, 5);
+void Cpu::opDivu(const Instruction &instruction) {
+    u8 a = instruction.rs;
+    u8 b = instruction.rt;
 
     DISASM("divu", "{} / {}", REGVAL(a), REGVAL(b));
 
@@ -96,219 +103,219 @@ void Cpu::opDivu(u32 instruction) {
     registers.lo = result;
     registers.hi = remainder;
 }
-void Cpu::opMfhi(u32 instruction) {
-    u8 dest = shift(instruction, 11, 5);
+void Cpu::opMfhi(const Instruction &instruction) {
+    u8 dest = instruction.rd;
 
     DISASM("mfhi", "{}, $HI", REGNAME(dest));
 
     registers.regs[dest] = registers.hi;
 }
-void Cpu::opMthi(u32 instruction) {
-    u8 src = shift(instruction, 21, 5);
+void Cpu::opMthi(const Instruction &instruction) {
+    u8 src = instruction.rs;
 
     DISASM("mthi", "$HI, {}", REGFMT(src, hex));
 
     registers.hi = registers.regs[src];
 }
-void Cpu::opMflo(u32 instruction) {
-    u8 dest = shift(instruction, 11, 5);
+void Cpu::opMflo(const Instruction &instruction) {
+    u8 dest = instruction.rd;
 
     DISASM("mflo", "{}, $LO", REGNAME(dest));
 
     registers.regs[dest] = registers.lo;
 }
-void Cpu::opMtlo(u32 instruction) {
-    u8 src = shift(instruction, 21, 5);
+void Cpu::opMtlo(const Instruction &instruction) {
+    u8 src = instruction.rs;
 
     DISASM("mtlo", "$LO, {}", REGFMT(src, hex));
 
     registers.lo = registers.regs[src];
 }
-void Cpu::opSll(u32 instruction) {
-    u8 move = shift(instruction, 6, 5);
-    u8 dest = shift(instruction, 11, 5);
-    u8 src = shift(instruction, 16, 5);
+void Cpu::opSll(const Instruction &instruction) {
+    u8 move = instruction.sa;
+    u8 dest = instruction.rd;
+    u8 src = instruction.rt;
 
-    if (instruction == 0)
+    if (instruction.word == 0)
         DISASM("nop", "", "");
     else
         DISASM("sll", "{}, {} << {}", REGNAME(dest), REGFMT(src, hex), move);
 
     registers.regs[dest] = static_cast<u64>(registers.regs[src]) << move;
 }
-void Cpu::opSrl(u32 instruction) {
-    u8 move = shift(instruction, 6, 5);
-    u8 dest = shift(instruction, 11, 5);
-    u8 src = shift(instruction, 16, 5);
+void Cpu::opSrl(const Instruction &instruction) {
+    u8 move = instruction.sa;
+    u8 dest = instruction.rd;
+    u8 src = instruction.rt;
 
     DISASM("srl", "{}, {} >> {}", REGNAME(dest), REGFMT(src, hex), move);
 
     registers.regs[dest] = static_cast<u64>(registers.regs[src]) >> move;
 }
-void Cpu::opSra(u32 instruction) {
-    u8 move = shift(instruction, 6, 5);
-    u8 dest = shift(instruction, 11, 5);
-    u8 src = shift(instruction, 16, 5);
+void Cpu::opSra(const Instruction &instruction) {
+    u8 move = instruction.sa;
+    u8 dest = instruction.rd;
+    u8 src = instruction.rt;
 
     DISASM("sra", "{}, {} >> {}", REGNAME(dest), REGFMT(src, hex), move);
-    unimplemented("sra: doesn't use proper i32 for shift, see warning", instruction);
+    unimplemented("sra: doesn't use proper i32 for shift, see warning", instruction.word);
 
     registers.regs[dest] = static_cast<u32>(registers.regs[src]) >> move;
 }
-void Cpu::opSllv(u32 instruction) {
-    u8 dest = shift(instruction, 11, 5);
-    u8 a = shift(instruction, 16, 5);
-    u8 b = shift(instruction, 21, 5);
+void Cpu::opSllv(const Instruction &instruction) {
+    u8 dest = instruction.rd;
+    u8 a = instruction.rt;
+    u8 b = instruction.rs;
 
     DISASM("sllv", "{}, {} << {}", REGNAME(dest), REGFMT(a, hex), REGVAL(b));
 
     registers.regs[dest] = static_cast<u64>(registers.regs[a]) << static_cast<u64>(registers.regs[b]);
 }
-void Cpu::opSrlv(u32 instruction) {
-    u8 dest = shift(instruction, 11, 5);
-    u8 a = shift(instruction, 16, 5);
-    u8 b = shift(instruction, 21, 5);
+void Cpu::opSrlv(const Instruction &instruction) {
+    u8 dest = instruction.rd;
+    u8 a = instruction.rt;
+    u8 b = instruction.rs;
 
     DISASM("srlv", "{}, {} >> {}", REGNAME(dest), REGFMT(a, hex), REGVAL(b));
 
     registers.regs[dest] = static_cast<u64>(registers.regs[a]) >> static_cast<u64>(registers.regs[b]);
 }
-void Cpu::opSrav(u32 instruction) {
-    u8 dest = shift(instruction, 11, 5);
-    u8 a = shift(instruction, 16, 5);
-    u8 b = shift(instruction, 21, 5);
+void Cpu::opSrav(const Instruction &instruction) {
+    u8 dest = instruction.rd;
+    u8 a = instruction.rt;
+    u8 b = instruction.rs;
 
     DISASM("srav", "{}, {} >> {}", REGNAME(dest), REGFMT(a, hex), REGVAL(b));
-    unimplemented("srav: doesn't use proper i32 for shift, see warning", instruction);
+    unimplemented("srav: doesn't use proper i32 for shift, see warning", instruction.word);
 
     registers.regs[dest] = static_cast<u32>(registers.regs[a]) >> static_cast<u64>(registers.regs[b]);
 }
-void Cpu::opSlt(u32 instruction) {
-    u8 dest = shift(instruction, 11, 5);
-    u8 a = shift(instruction, 16, 5);
-    u8 b = shift(instruction, 21, 5);
+void Cpu::opSlt(const Instruction &instruction) {
+    u8 dest = instruction.rd;
+    u8 a = instruction.rt;
+    u8 b = instruction.rs;
 
     DISASM("slt", "{}, {} < {}", REGNAME(dest), REGVAL(a), REGVAL(b));
 
     registers.regs[dest] = registers.regs[b] < registers.regs[a];
 }
-void Cpu::opSltu(u32 instruction) {
-    u8 dest = shift(instruction, 11, 5);
-    u8 a = shift(instruction, 16, 5);
-    u8 b = shift(instruction, 21, 5);
+void Cpu::opSltu(const Instruction &instruction) {
+    u8 dest = instruction.rd;
+    u8 a = instruction.rt;
+    u8 b = instruction.rs;
 
     DISASM("sltu", "{}, {} < {}", REGNAME(dest), REGVAL(b), REGVAL(a));
 
     registers.regs[dest] = static_cast<u64>(registers.regs[b]) < static_cast<u64>(registers.regs[a]);
 }
-void Cpu::opAnd(u32 instruction) {
-    u8 dest = shift(instruction, 11, 5);
-    u8 a = shift(instruction, 16, 5);
-    u8 b = shift(instruction, 21, 5);
+void Cpu::opAnd(const Instruction &instruction) {
+    u8 dest = instruction.rd;
+    u8 a = instruction.rt;
+    u8 b = instruction.rs;
 
     DISASM("and", "{}, {} & {}", REGNAME(dest), REGFMT(a, hex), REGFMT(b, hex));
 
     registers.regs[dest] = static_cast<u64>(registers.regs[a]) & static_cast<u64>(registers.regs[b]);
 }
-void Cpu::opOr(u32 instruction) {
-    u8 dest = shift(instruction, 11, 5);
-    u8 a = shift(instruction, 16, 5);
-    u8 b = shift(instruction, 21, 5);
+void Cpu::opOr(const Instruction &instruction) {
+    u8 dest = instruction.rd;
+    u8 a = instruction.rt;
+    u8 b = instruction.rs;
 
     DISASM("or", "{}, {} | {}", REGNAME(dest), REGFMT(a, hex), REGFMT(b, hex));
 
     registers.regs[dest] = static_cast<u64>(registers.regs[a]) | static_cast<u64>(registers.regs[b]);
 }
-void Cpu::opXor(u32 instruction) {
-    u8 dest = shift(instruction, 11, 5);
-    u8 a = shift(instruction, 16, 5);
-    u8 b = shift(instruction, 21, 5);
+void Cpu::opXor(const Instruction &instruction) {
+    u8 dest = instruction.rd;
+    u8 a = instruction.rt;
+    u8 b = instruction.rs;
 
     DISASM("xor", "{}, {} ^ {}", REGNAME(dest), REGFMT(a, hex), REGFMT(b, hex));
 
     registers.regs[dest] = static_cast<u64>(registers.regs[a]) ^ static_cast<u64>(registers.regs[b]);
 }
-void Cpu::opNor(u32 instruction) {
-    u8 dest = shift(instruction, 11, 5);
-    u8 a = shift(instruction, 16, 5);
-    u8 b = shift(instruction, 21, 5);
+void Cpu::opNor(const Instruction &instruction) {
+    u8 dest = instruction.rd;
+    u8 a = instruction.rt;
+    u8 b = instruction.rs;
 
     DISASM("nor", "{}, ~({} | {})", REGNAME(dest), REGFMT(a, hex), REGFMT(b, hex));
 
     registers.regs[dest] = ~(static_cast<u64>(registers.regs[a]) | static_cast<u64>(registers.regs[b]));
 }
-void Cpu::opSyscall(u32 instruction) {
-    unimplemented("Syscall", instruction);
+void Cpu::opSyscall(const Instruction &instruction) {
+    unimplemented("Syscall", instruction.word);
 }
-void Cpu::opBreak(u32 instruction) {
-    unimplemented("Break", instruction);
+void Cpu::opBreak(const Instruction &instruction) {
+    unimplemented("Break", instruction.word);
 }
-void Cpu::opAddi(u32 instruction) {
-    i16 value = shift(instruction, 0, 16);
-    u8 dest = shift(instruction, 16, 5);
-    u8 src = shift(instruction, 21, 5);
+void Cpu::opAddi(const Instruction &instruction) {
+    i16 value = instruction.immediate;
+    u8 dest = instruction.rt;
+    u8 src = instruction.rs;
 
     DISASM("addi", "{}, {} + {}", REGNAME(dest), REGVAL(src), value);
 
     registers.regs[dest] = registers.regs[src] + value;
 }
-void Cpu::opAddiu(u32 instruction) {
-    i16 value = shift(instruction, 0, 16);
-    u8 dest = shift(instruction, 16, 5);
-    u8 src = shift(instruction, 21, 5);
+void Cpu::opAddiu(const Instruction &instruction) {
+    i16 value = instruction.immediate;
+    u8 dest = instruction.rt;
+    u8 src = instruction.rs;
 
     DISASM("addiu", "{}, {} + {}", REGNAME(dest), REGVAL(src), value);
 
     registers.regs[dest] = registers.regs[src] + value;
 }
-void Cpu::opSlti(u32 instruction) {
-    i16 value = shift(instruction, 0, 16);
-    u8 dest = shift(instruction, 16, 5);
-    u8 src = shift(instruction, 21, 5);
+void Cpu::opSlti(const Instruction &instruction) {
+    i16 value = instruction.immediate;
+    u8 dest = instruction.rt;
+    u8 src = instruction.rs;
 
     DISASM("slti", "{}, {} < {}", REGNAME(dest), REGVAL(src), value);
 
     registers.regs[dest] = registers.regs[src] < value;
 }
-void Cpu::opSltiu(u32 instruction) {
-    u16 value = shift(instruction, 0, 16);
-    u8 dest = shift(instruction, 16, 5);
-    u8 src = shift(instruction, 21, 5);
+void Cpu::opSltiu(const Instruction &instruction) {
+    u16 value = instruction.immediate;
+    u8 dest = instruction.rt;
+    u8 src = instruction.rs;
 
     DISASM("sltiu", "{}, {} < {}", REGNAME(dest), REGVAL(src), value);
 
     registers.regs[dest] = static_cast<u64>(registers.regs[src]) < value;
 }
-void Cpu::opAndi(u32 instruction) {
-    u16 value = shift(instruction, 0, 16);
-    u8 dest = shift(instruction, 16, 5);
-    u8 src = shift(instruction, 21, 5);
+void Cpu::opAndi(const Instruction &instruction) {
+    u16 value = instruction.immediate;
+    u8 dest = instruction.rt;
+    u8 src = instruction.rs;
 
     DISASM("andi", "{}, {} & {}", REGNAME(dest), REGFMT(src, hex), fmt::format(hex, value));
 
     registers.regs[dest] = static_cast<u64>(registers.regs[src]) & value;
 }
-void Cpu::opOri(u32 instruction) {
-    u16 value = shift(instruction, 0, 16);
-    u8 dest = shift(instruction, 16, 5);
-    u8 src = shift(instruction, 21, 5);
+void Cpu::opOri(const Instruction &instruction) {
+    u16 value = instruction.immediate;
+    u8 dest = instruction.rt;
+    u8 src = instruction.rs;
 
     DISASM("ori", "{}, {} | {}", REGNAME(dest), REGFMT(src, hex), fmt::format(hex, value));
 
     registers.regs[dest] = static_cast<u64>(registers.regs[src]) | value;
 }
-void Cpu::opXori(u32 instruction) {
-    u16 value = shift(instruction, 0, 16);
-    u8 dest = shift(instruction, 16, 5);
-    u8 src = shift(instruction, 21, 5);
+void Cpu::opXori(const Instruction &instruction) {
+    u16 value = instruction.immediate;
+    u8 dest = instruction.rt;
+    u8 src = instruction.rs;
 
     DISASM("xori", "{}, {} ^ {}", REGNAME(dest), REGFMT(src, hex), fmt::format(hex, value));
 
     registers.regs[dest] = static_cast<u64>(registers.regs[src]) ^ value;
 }
-void Cpu::opLui(u32 instruction) {
-    u16 value = shift(instruction, 0, 16);
-    u8 dest = shift(instruction, 16, 5);
+void Cpu::opLui(const Instruction &instruction) {
+    u16 value = instruction.immediate;
+    u8 dest = instruction.rt;
 
     DISASM("lui", "{}, {}", REGNAME(dest), fmt::format(hex, static_cast<u64>(value) << 16u));
 
@@ -317,287 +324,338 @@ void Cpu::opLui(u32 instruction) {
 
     registers.regs[dest] = static_cast<u64>(value) << 16u;
 }
-void Cpu::opBeq(u32 instruction) {
-    i16 value = shift(instruction, 0, 16);
-    u8 a = shift(instruction, 16, 5);
-    u8 b = shift(instruction, 21, 5);
+void Cpu::opBeq(const Instruction &instruction) {
+    i16 value = instruction.immediate;
+    u8 a = instruction.rt;
+    u8 b = instruction.rs;
 
     DISASM("beq", "{}, {} == {}", REGBRANCH(value), REGVAL(a), REGVAL(b));
 
     if (registers.regs[a] == registers.regs[b]) {
-        delay([this, value]() {
-            registers.pc += (value - 1) * sizeof(u32);
-        });
+        delay(registers.pc + (value + 1) * sizeof(u32));
     }
 }
-void Cpu::opBne(u32 instruction) {
-    i16 value = shift(instruction, 0, 16);
-    u8 a = shift(instruction, 16, 5);
-    u8 b = shift(instruction, 21, 5);
+void Cpu::opBne(const Instruction &instruction) {
+    i16 value = instruction.immediate;
+    u8 a = instruction.rt;
+    u8 b = instruction.rs;
 
     DISASM("bne", "{}, {} != {}", REGBRANCH(value), REGVAL(a), REGVAL(b));
 
     if (registers.regs[a] != registers.regs[b]) {
-        delay([this, value]() {
-            registers.pc += (value - 1) * sizeof(u32);
-        });
+        delay(registers.pc + (value + 1) * sizeof(u32));
     }
 }
-void Cpu::opBlez(u32 instruction) {
-    i16 value = shift(instruction, 0, 16);
-    u8 src = shift(instruction, 21, 5);
+void Cpu::opBlez(const Instruction &instruction) {
+    i16 value = instruction.immediate;
+    u8 src = instruction.rs;
 
     DISASM("blez", "{}, {} <= 0", REGBRANCH(value), REGVAL(src));
 
     if (registers.regs[src] <= 0) {
-        delay([this, value]() {
-            registers.pc += (value - 1) * sizeof(u32);
-        });
+        delay(registers.pc + (value + 1) * sizeof(u32));
     }
 }
-void Cpu::opBgtz(u32 instruction) {
-    i16 value = shift(instruction, 0, 16);
-    u8 src = shift(instruction, 21, 5);
+void Cpu::opBgtz(const Instruction &instruction) {
+    i16 value = instruction.immediate;
+    u8 src = instruction.rs;
 
     DISASM("bgtz", "{}, {} > 0", REGBRANCH(value), REGVAL(src));
 
     if (registers.regs[src] > 0) {
-        delay([this, value]() {
-            registers.pc += (value - 1) * sizeof(u32);
-        });
+        delay(registers.pc + (value + 1) * sizeof(u32));
     }
 }
-void Cpu::opBltz(u32 instruction) {
-    i16 value = shift(instruction, 0, 16);
-    u8 src = shift(instruction, 21, 5);
+void Cpu::opBltz(const Instruction &instruction) {
+    i16 value = instruction.immediate;
+    u8 src = instruction.rs;
 
     DISASM("bltz", "{}, {} < 0", REGBRANCH(value), REGVAL(src));
 
     if (registers.regs[src] < 0) {
-        delay([this, value]() {
-            registers.pc += (value - 1) * sizeof(u32);
-        });
+        delay(registers.pc + (value + 1) * sizeof(u32));
     }
 }
-void Cpu::opBgez(u32 instruction) {
-    i16 value = shift(instruction, 0, 16);
-    u8 src = shift(instruction, 21, 5);
+void Cpu::opBgez(const Instruction &instruction) {
+    i16 value = instruction.immediate;
+    u8 src = instruction.rs;
 
     DISASM("bgez", "{}, {} >= 0", REGBRANCH(value), REGVAL(src));
 
     if (registers.regs[src] >= 0) {
-        delay([this, value]() {
-            registers.pc += (value - 1) * sizeof(u32);
-        });
+        delay(registers.pc + (value + 1) * sizeof(u32));
     }
 }
-void Cpu::opBltzal(u32 instruction) {
-    i16 value = shift(instruction, 0, 16);
-    u8 src = shift(instruction, 21, 5);
+void Cpu::opBltzal(const Instruction &instruction) {
+    i16 value = instruction.immediate;
+    u8 src = instruction.rs;
 
     DISASM("bltzal", "{}, {} < 0 (&link)", REGBRANCH(value), REGVAL(src));
 
+    u64 target = registers.pc + (value + 1) * sizeof(u32);
+
+    registers.regs[static_cast<u8>(RegisterIndex::Link)] = registers.pc + 2 * sizeof(u32);
+
     if (registers.regs[src] < 0) {
-        delay([this, value]() {
-            registers.regs[static_cast<u8>(RegisterIndex::Link)] = registers.pc + sizeof(u32);
-            registers.pc += (value - 1) * sizeof(u32);
-        });
+        delay(target);
     }
 }
-void Cpu::opBgezal(u32 instruction) {
-    i16 value = shift(instruction, 0, 16);
-    u8 src = shift(instruction, 21, 5);
+void Cpu::opBgezal(const Instruction &instruction) {
+    i16 value = instruction.immediate;
+    u8 src = instruction.rs;
 
     DISASM("bgezal", "{}, {} >= 0 (&link)", REGBRANCH(value), REGVAL(src));
 
+    u64 target = registers.pc + (value + 1) * sizeof(u32);
+
+    registers.regs[static_cast<u8>(RegisterIndex::Link)] = registers.pc + 2 * sizeof(u32);
+
     if (registers.regs[src] >= 0) {
-        delay([this, value]() {
-            registers.regs[static_cast<u8>(RegisterIndex::Link)] = registers.pc + sizeof(u32);
-            registers.pc += (value - 1) * sizeof(u32);
-        });
+        delay(target);
     }
 }
-void Cpu::opBeql(u32 instruction) {
-    i16 value = shift(instruction, 0, 16);
-    u8 a = shift(instruction, 16, 5);
-    u8 b = shift(instruction, 21, 5);
+void Cpu::opBeql(const Instruction &instruction) {
+    i16 value = instruction.immediate;
+    u8 a = instruction.rt;
+    u8 b = instruction.rs;
 
     DISASM("beql", "{}, {} == {}", REGBRANCH(value), REGVAL(a), REGVAL(b));
 
     if (registers.regs[a] == registers.regs[b]) {
-        delay([this, value]() {
-            registers.pc += (value - 1) * sizeof(u32);
-        });
+        delay(registers.pc + (value + 1) * sizeof(u32));
+    } else {
+        nullify();
     }
 }
-void Cpu::opBnel(u32 instruction) {
-    i16 value = shift(instruction, 0, 16);
-    u8 a = shift(instruction, 16, 5);
-    u8 b = shift(instruction, 21, 5);
+void Cpu::opBnel(const Instruction &instruction) {
+    i16 value = instruction.immediate;
+    u8 a = instruction.rt;
+    u8 b = instruction.rs;
 
     DISASM("bnel", "{}, {} != {}", REGBRANCH(value), REGVAL(a), REGVAL(b));
 
     if (registers.regs[a] != registers.regs[b]) {
-        delay([this, value]() {
-            registers.pc += (value - 1) * sizeof(u32);
-        });
+        delay(registers.pc + (value + 1) * sizeof(u32));
+    } else {
+        nullify();
     }
 }
-void Cpu::opBlezl(u32 instruction) {
-    i16 value = shift(instruction, 0, 16);
-    u8 src = shift(instruction, 21, 5);
+void Cpu::opBlezl(const Instruction &instruction) {
+    i16 value = instruction.immediate;
+    u8 src = instruction.rs;
 
     DISASM("blezl", "{}, {} <= 0", REGBRANCH(value), REGVAL(src));
 
     if (registers.regs[src] <= 0) {
-        delay([this, value]() {
-            registers.pc += (value - 1) * sizeof(u32);
-        });
+        delay(registers.pc + (value + 1) * sizeof(u32));
+    } else {
+        nullify();
     }
 }
-void Cpu::opBgtzl(u32 instruction) {
-    i16 value = shift(instruction, 0, 16);
-    u8 src = shift(instruction, 21, 5);
+void Cpu::opBgtzl(const Instruction &instruction) {
+    i16 value = instruction.immediate;
+    u8 src = instruction.rs;
 
     DISASM("bgtzl", "{}, {} > 0", REGBRANCH(value), REGVAL(src));
 
     if (registers.regs[src] > 0) {
-        delay([this, value]() {
-            registers.pc += (value - 1) * sizeof(u32);
-        });
+        delay(registers.pc + (value + 1) * sizeof(u32));
+    } else {
+        nullify();
     }
 }
-void Cpu::opJ(u32 instruction) {
-    u32 value = shift(instruction, 0, 26);
+void Cpu::opJ(const Instruction &instruction) {
+    u32 value = shift(instruction.word, 0, 26);
     u32 address = (registers.pc & 0xF0000000u) | (value * sizeof(u32));
 
     DISASM("j", "{}", fmt::format(hex, address));
 
-    delay([this, address]() {
-        registers.pc = address;
-    });
+    delay(address);
 }
-void Cpu::opJal(u32 instruction) {
-    u32 value = shift(instruction, 0, 26);
+void Cpu::opJal(const Instruction &instruction) {
+    u32 value = shift(instruction.word, 0, 26);
     u32 address = (registers.pc & 0xF0000000u) | (value * sizeof(u32));
 
     DISASM("jal", "{} (&link)", fmt::format(hex, address));
 
-    delay([this, address]() {
-        registers.regs[static_cast<u8>(RegisterIndex::Link)] = registers.pc;
-        registers.pc = address;
-    });
+    registers.regs[static_cast<u8>(RegisterIndex::Link)] = registers.pc + 2 * sizeof(u32);
+    delay(address);
 }
-void Cpu::opJr(u32 instruction) {
-    u8 src = shift(instruction, 21, 5);
+void Cpu::opJr(const Instruction &instruction) {
+    u8 src = instruction.rs;
 
     DISASM("jr", "{}", REGFMT(src, hex));
 
-    delay([this, src]() {
-        registers.pc = registers.regs[src];
-    });
+    delay(registers.regs[src]);
 }
-void Cpu::opJalr(u32 instruction) {
-    u8 src = shift(instruction, 21, 5);
-    u8 dest = shift(instruction, 11, 5);
+void Cpu::opJalr(const Instruction &instruction) {
+    u8 src = instruction.rs;
+    u8 dest = instruction.rd;
 
     DISASM("jalr", "{} (&{})", REGFMT(src, hex), REGNAME(dest));
 
-    delay([this, src, dest]() {
-        registers.regs[dest] = registers.pc;
-        registers.pc = registers.regs[src];
-    });
+    u64 target = registers.regs[src];
+
+    registers.regs[dest] = registers.pc + 2 * sizeof(u32);
+    delay(target);
 }
-void Cpu::opCache(u32 instruction) {
-    unimplemented("Cache", instruction);
+void Cpu::opCache(const Instruction &instruction) {
+    unimplemented("Cache", instruction.word);
 }
-void Cpu::opLb(u32 instruction) {
-    i16 value = shift(instruction, 0, 16);
-    u8 dest = shift(instruction, 16, 5);
-    u8 src = shift(instruction, 21, 5);
+void Cpu::opLb(const Instruction &instruction) {
+    i16 value = instruction.immediate;
+    u8 dest = instruction.rt;
+    u8 src = instruction.rs;
 
     DISASM("lb", "{}, [{} + {}]", REGNAME(dest), REGFMT(src, hex), value);
 
     registers.regs[dest] = memory.getByte(registers.regs[src] + value);
 }
-void Cpu::opLh(u32 instruction) {
-    i16 value = shift(instruction, 0, 16);
-    u8 dest = shift(instruction, 16, 5);
-    u8 src = shift(instruction, 21, 5);
+void Cpu::opLh(const Instruction &instruction) {
+    i16 value = instruction.immediate;
+    u8 dest = instruction.rt;
+    u8 src = instruction.rs;
 
     DISASM("lh", "{}, [{} + {}]", REGNAME(dest), REGFMT(src, hex), value);
 
     registers.regs[dest] = memory.get<u16>(registers.regs[src] + value);
 }
-void Cpu::opLwl(u32 instruction) {
-    unimplemented("Lwl", instruction);
+void Cpu::opLwl(const Instruction &instruction) {
+    unimplemented("Lwl", instruction.word);
 }
-void Cpu::opLw(u32 instruction) {
-    i16 value = shift(instruction, 0, 16);
-    u8 dest = shift(instruction, 16, 5);
-    u8 src = shift(instruction, 21, 5);
+void Cpu::opLw(const Instruction &instruction) {
+    i16 value = instruction.immediate;
+    u8 dest = instruction.rt;
+    u8 src = instruction.rs;
 
     DISASM("lw", "{}, [{} + {}]", REGNAME(dest), REGFMT(src, hex), value);
 
     registers.regs[dest] = memory.get<u32>(registers.regs[src] + value);
 }
-void Cpu::opLbu(u32 instruction) {
-    u16 value = shift(instruction, 0, 16);
-    u8 dest = shift(instruction, 16, 5);
-    u8 src = shift(instruction, 21, 5);
+void Cpu::opLbu(const Instruction &instruction) {
+    u16 value = instruction.immediate;
+    u8 dest = instruction.rt;
+    u8 src = instruction.rs;
 
     DISASM("lbu", "{}, [{} + {}]", REGNAME(dest), REGFMT(src, hex), value);
 
     registers.regs[dest] = memory.getByte(registers.regs[src] + value);
 }
-void Cpu::opLhu(u32 instruction) {
-    i16 value = shift(instruction, 0, 16);
-    u8 dest = shift(instruction, 16, 5);
-    u8 src = shift(instruction, 21, 5);
+void Cpu::opLhu(const Instruction &instruction) {
+    i16 value = instruction.immediate;
+    u8 dest = instruction.rt;
+    u8 src = instruction.rs;
 
     DISASM("lhu", "{}, [{} + {}]", REGNAME(dest), REGFMT(src, hex), value);
 
     registers.regs[dest] = memory.get<u16>(registers.regs[src] + value);
 }
-void Cpu::opLwr(u32 instruction) {
-    unimplemented("Lwr", instruction);
+void Cpu::opLwr(const Instruction &instruction) {
+    unimplemented("Lwr", instruction.word);
 }
-void Cpu::opSb(u32 instruction) {
-    i16 value = shift(instruction, 0, 16);
-    u8 src = shift(instruction, 16, 5);
-    u8 dest = shift(instruction, 21, 5);
+void Cpu::opSb(const Instruction &instruction) {
+    i16 value = instruction.immediate;
+    u8 src = instruction.rt;
+    u8 dest = instruction.rs;
 
     DISASM("sb", "[{} + {}], {}", REGFMT(dest, hex), value, REGFMT(src, hex));
 
     memory.setByte(registers.regs[dest] + value, registers.regs[src]);
 }
-void Cpu::opSh(u32 instruction) {
-    i16 value = shift(instruction, 0, 16);
-    u8 src = shift(instruction, 16, 5);
-    u8 dest = shift(instruction, 21, 5);
+void Cpu::opSh(const Instruction &instruction) {
+    i16 value = instruction.immediate;
+    u8 src = instruction.rt;
+    u8 dest = instruction.rs;
 
     DISASM("sh", "[{} + {}], {}", REGFMT(dest, hex), value, REGFMT(src, hex));
 
     memory.set<u16>(registers.regs[dest] + value, registers.regs[src]);
 }
-void Cpu::opSwl(u32 instruction) {
-    unimplemented("Swl", instruction);
+void Cpu::opSwl(const Instruction &instruction) {
+    unimplemented("Swl", instruction.word);
 }
-void Cpu::opSw(u32 instruction) {
-    i16 value = shift(instruction, 0, 16);
-    u8 src = shift(instruction, 16, 5);
-    u8 dest = shift(instruction, 21, 5);
+void Cpu::opSw(const Instruction &instruction) {
+    i16 value = instruction.immediate;
+    u8 src = instruction.rt;
+    u8 dest = instruction.rs;
 
     DISASM("sw", "[{} + {}], {}", REGFMT(dest, hex), value, REGFMT(src, hex));
 
     memory.set<u32>(registers.regs[dest] + value, registers.regs[src]);
 }
-void Cpu::opSwr(u32 instruction) {
-    unimplemented("Swr", instruction);
+void Cpu::opSwr(const Instruction &instruction) {
+    unimplemented("Swr", instruction.word);
+}
+void Cpu::opMtc0(const Instruction &instruction) {
+    u8 src = instruction.rt;
+    u8 dest = instruction.rd;
+
+    DISASM("mtc0", "$c{}, {}", dest, REGFMT(src, hex));
+
+    u32 value = registers.regs[src];
+
+    switch (dest) {
+        case Cop0::count:
+            cop0.countStart = cycles - (static_cast<u64>(value) << 1);
+            scheduleCompare();
+            break;
+        case Cop0::compare:
+            cop0.regs[dest] = value;
+            cop0.regs[Cop0::cause] &= ~Cop0::timerInterrupt;
+            scheduleCompare();
+            break;
+        case Cop0::cause:
+            cop0.regs[dest] = (cop0.regs[dest] & ~Cop0::softwareInterrupts) | (value & Cop0::softwareInterrupts);
+            scheduler.schedule(EventType::Interrupt, cycles);
+            break;
+        case Cop0::status:
+            cop0.regs[dest] = value;
+            scheduler.schedule(EventType::Interrupt, cycles);
+            break;
+        default:
+            cop0.regs[dest] = value;
+            break;
+    }
+}
+void Cpu::opMfc0(const Instruction &instruction) {
+    u8 dest = instruction.rt;
+    u8 src = instruction.rd;
+
+    u32 value = src == Cop0::count ? count() : cop0.regs[src];
+
+    if (src == Cop0::cause && memory.interrupted())
+        value |= Cop0::rcpInterrupt;
+
+    DISASM("mfc0", "{}, $c{}@0x{:0>8X}", REGNAME(dest), src, value);
+
+    registers.regs[dest] = static_cast<i32>(value);
 }
-void Cpu::opMtc0(u32 instruction) {
-    unimplemented("Mtc0", instruction);
+void Cpu::opEret(const Instruction &instruction) {
+    if (shift(instruction.word, 0, 6) != 0b011000) {
+        unimplemented("TLB", instruction.word);
+        return;
+    }
+
+    u32 &status = cop0.regs[Cop0::status];
+    u32 target;
+
+    if (status & Cop0::errorLevel) {
+        target = cop0.regs[Cop0::errorEpc];
+        status &= ~Cop0::errorLevel;
+    } else {
+        target = cop0.regs[Cop0::epc];
+        status &= ~Cop0::exceptionLevel;
+    }
+
+    DISASM("eret", "{}", fmt::format(hex, target));
+
+    registers.llb = 0;
+    // step moves past the instruction it ran
+    registers.pc = target - sizeof(u32);
+
+    // whatever is still pending can be taken again now
+    scheduler.schedule(EventType::Interrupt, cycles);
 }
-void Cpu::opMfc0(u32 instruction) {
-    unimplemented("Mfc0", instruction);
+void Cpu::opReserved(const Instruction &instruction) {
+    unimplemented("Reserved", instruction.word);
 }
\ No newline at end of file
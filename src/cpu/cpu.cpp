@@ -1,7 +1,13 @@
 #include <cpu/cpu.h>
+#include <cpu/rewind.h>
+#include <cpu/rsp.h>
+
+#include <util/log.h>
 
 #include <fmt/printf.h>
 
+#include <algorithm>
+
 const char *getRegisterName(RegisterIndex index) {
     switch (index) {
         case RegisterIndex::Zero: return "0";
@@ -39,130 +45,587 @@ const char *getRegisterName(RegisterIndex index) {
     }
 }
 
-void Cpu::unimplemented(const std::string &name, u32 instruction) {
-    fmt::print("Unimplemented {} instruction: 0b{:0>32b}.\n", name, instruction);
+void Cpu::unimplemented(const char *name, u32 instruction) {
+    if (profiler)
+        profiler->miss(name);
+
+    logUnimplemented(LogKind::Instruction, instruction, 0, name);
 }
 
-void Cpu::step() {
-    u32 instruction = memory.get<u32>(registers.pc);
+constexpr DispatchTable Cpu::dispatchTable() {
+    DispatchTable table;
+
+    for (u32 a = 0; a < DispatchTable::levels * DispatchTable::entries; a++) {
+        table.handlers[a] = &Cpu::opReserved;
+        table.names[a] = "reserved";
+    }
+
+    // opcodes decode directly by default, the three with a secondary field point at their own level
+    for (u32 a = 0; a < DispatchTable::entries; a++)
+        table.route(a, 0, 26, 6);
+
+    table.route(0b000000, 1, 0, 6); // ALU, funct
+    table.route(0b000001, 2, 16, 5); // Flow, rt
+    table.route(0b010000, 3, 21, 5); // COP0, rs
+
+    constexpr u32 primary = 0;
+    constexpr u32 special = 1;
+    constexpr u32 regimm = 2;
+    constexpr u32 cop0 = 3;
+
+    table.set(special, 0b100000, &Cpu::opAdd, "add");
+    table.set(special, 0b100001, &Cpu::opAddu, "addu");
+    table.set(special, 0b100010, &Cpu::opSub, "sub");
+    table.set(special, 0b100011, &Cpu::opSubu, "subu");
+    table.set(special, 0b011000, &Cpu::opMult, "mult");
+    table.set(special, 0b011001, &Cpu::opMultu, "multu");
+    table.set(special, 0b011010, &Cpu::opDiv, "div");
+    table.set(special, 0b011011, &Cpu::opDivu, "divu");
+    table.set(special, 0b010000, &Cpu::opMfhi, "mfhi");
+    table.set(special, 0b010001, &Cpu::opMthi, "mthi");
+    table.set(special, 0b010010, &Cpu::opMflo, "mflo");
+    table.set(special, 0b010011, &Cpu::opMtlo, "mtlo");
+    table.set(special, 0b000000, &Cpu::opSll, "sll");
+    table.set(special, 0b000010, &Cpu::opSrl, "srl");
+    table.set(special, 0b000011, &Cpu::opSra, "sra");
+    table.set(special, 0b000100, &Cpu::opSllv, "sllv");
+    table.set(special, 0b000110, &Cpu::opSrlv, "srlv");
+    table.set(special, 0b000111, &Cpu::opSrav, "srav");
+    table.set(special, 0b101010, &Cpu::opSlt, "slt");
+    table.set(special, 0b101011, &Cpu::opSltu, "sltu");
+    table.set(special, 0b100100, &Cpu::opAnd, "and");
+    table.set(special, 0b100101, &Cpu::opOr, "or");
+    table.set(special, 0b100110, &Cpu::opXor, "xor");
+    table.set(special, 0b100111, &Cpu::opNor, "nor");
+    table.set(special, 0b001000, &Cpu::opJr, "jr");
+    table.set(special, 0b001001, &Cpu::opJalr, "jalr");
+    table.set(special, 0b001100, &Cpu::opSyscall, "syscall");
+    table.set(special, 0b001101, &Cpu::opBreak, "break");
+
+    table.set(primary, 0b001000, &Cpu::opAddi, "addi");
+    table.set(primary, 0b001001, &Cpu::opAddiu, "addiu");
+    table.set(primary, 0b001010, &Cpu::opSlti, "slti");
+    table.set(primary, 0b001011, &Cpu::opSltiu, "sltiu");
+    table.set(primary, 0b001100, &Cpu::opAndi, "andi");
+    table.set(primary, 0b001101, &Cpu::opOri, "ori");
+    table.set(primary, 0b001110, &Cpu::opXori, "xori");
+    table.set(primary, 0b001111, &Cpu::opLui, "lui");
+    table.set(primary, 0b000100, &Cpu::opBeq, "beq");
+    table.set(primary, 0b000101, &Cpu::opBne, "bne");
+    table.set(primary, 0b000110, &Cpu::opBlez, "blez");
+    table.set(primary, 0b000111, &Cpu::opBgtz, "bgtz");
+    table.set(primary, 0b010100, &Cpu::opBeql, "beql");
+    table.set(primary, 0b010101, &Cpu::opBnel, "bnel");
+    table.set(primary, 0b010110, &Cpu::opBlezl, "blezl");
+    table.set(primary, 0b010111, &Cpu::opBgtzl, "bgtzl");
+    table.set(primary, 0b000010, &Cpu::opJ, "j");
+    table.set(primary, 0b000011, &Cpu::opJal, "jal");
+    table.set(primary, 0b100000, &Cpu::opLb, "lb");
+    table.set(primary, 0b100001, &Cpu::opLh, "lh");
+    table.set(primary, 0b100010, &Cpu::opLwl, "lwl");
+    table.set(primary, 0b100011, &Cpu::opLw, "lw");
+    table.set(primary, 0b100100, &Cpu::opLbu, "lbu");
+    table.set(primary, 0b100101, &Cpu::opLhu, "lhu");
+    table.set(primary, 0b100110, &Cpu::opLwr, "lwr");
+    table.set(primary, 0b101000, &Cpu::opSb, "sb");
+    table.set(primary, 0b101001, &Cpu::opSh, "sh");
+    table.set(primary, 0b101010, &Cpu::opSwl, "swl");
+    table.set(primary, 0b101011, &Cpu::opSw, "sw");
+    table.set(primary, 0b101110, &Cpu::opSwr, "swr");
+    table.set(primary, 0b101111, &Cpu::opCache, "cache");
+
+    table.set(regimm, 0b00000, &Cpu::opBltz, "bltz");
+    table.set(regimm, 0b00001, &Cpu::opBgez, "bgez");
+    table.set(regimm, 0b10000, &Cpu::opBltzal, "bltzal");
+    table.set(regimm, 0b10001, &Cpu::opBgezal, "bgezal");
 
+    table.set(cop0, 0b00000, &Cpu::opMfc0, "mfc0");
+    table.set(cop0, 0b00100, &Cpu::opMtc0, "mtc0");
+    table.set(cop0, 0b10000, &Cpu::opEret, "eret"); // CO, only eret so far
+
+    return table;
+}
+
+const DispatchTable &Cpu::dispatch() {
+    static constexpr DispatchTable table = dispatchTable();
+
+    return table;
+}
+
+u16 Cpu::opcode(u32 instruction) {
+    const DispatchTable &table = dispatch();
+
+    u32 route = table.routes[instruction >> 26];
+
+    return (route >> 16) + ((instruction >> (route & 0xFF)) & ((route >> 8) & 0xFF));
+}
+
+const char *Cpu::opcodeName(u16 opcode) {
+    return dispatch().names[opcode];
+}
+
+bool Cpu::isBranch(u32 instruction) {
     u32 op = shift(instruction, 26, 6);
 
     switch (op) {
-        case 0b000000: { // ALU
+        case 0b000000: {
             u32 func = shift(instruction, 0, 6);
-            switch (func) {
-                case 0b100000: opAdd(instruction); break;
-                case 0b100001: opAddu(instruction); break;
-                case 0b100010: opSub(instruction); break;
-                case 0b100011: opSubu(instruction); break;
-                case 0b011000: opMult(instruction); break;
-                case 0b011001: opMultu(instruction); break;
-                case 0b011010: opDiv(instruction); break;
-                case 0b011011: opDivu(instruction); break;
-                case 0b010000: opMfhi(instruction); break;
-                case 0b010001: opMthi(instruction); break;
-                case 0b010010: opMflo(instruction); break;
-                case 0b010011: opMtlo(instruction); break;
-                case 0b000000: opSll(instruction); break;
-                case 0b000010: opSrl(instruction); break;
-                case 0b000011: opSra(instruction); break;
-                case 0b000100: opSllv(instruction); break;
-                case 0b000110: opSrlv(instruction); break;
-                case 0b000111: opSrav(instruction); break;
-                case 0b101010: opSlt(instruction); break;
-                case 0b101011: opSltu(instruction); break;
-                case 0b100100: opAnd(instruction); break;
-                case 0b100101: opOr(instruction); break;
-                case 0b100110: opXor(instruction); break;
-                case 0b100111: opNor(instruction); break;
-                case 0b001000: opJr(instruction); break;
-                case 0b001001: opJalr(instruction); break;
-                case 0b001100: opSyscall(instruction); break;
-                case 0b001101: opBreak(instruction); break;
-                default: assert(false);
-            }
-            break;
+            return func == 0b001000 || func == 0b001001; // jr, jalr
         }
+        case 0b000001: // regimm
+        case 0b000010: case 0b000011: // j, jal
+        case 0b000100: case 0b000101: case 0b000110: case 0b000111:
+        case 0b010100: case 0b010101: case 0b010110: case 0b010111:
+            return true;
+        default:
+            return false;
+    }
+}
+
+Instruction Cpu::decode(u32 word) {
+    Instruction instruction;
+
+    instruction.opcode = opcode(word);
+    instruction.handler = dispatch().handlers[instruction.opcode];
+    instruction.word = word;
+    instruction.branch = isBranch(word);
+    instruction.rs = shift(word, 21, 5);
+    instruction.rt = shift(word, 16, 5);
+    instruction.rd = shift(word, 11, 5);
+    instruction.sa = shift(word, 6, 5);
+    instruction.immediate = static_cast<i16>(shift(word, 0, 16));
+
+    return instruction;
+}
+
+void Cpu::invalidate(u32 page) {
+    cache.invalidate(page);
+    blocks.invalidate(page);
+}
 
-        case 0b001000: opAddi(instruction); break;
-        case 0b001001: opAddiu(instruction); break;
-        case 0b001010: opSlti(instruction); break;
-        case 0b001011: opSltiu(instruction); break;
-        case 0b001100: opAndi(instruction); break;
-        case 0b001101: opOri(instruction); break;
-        case 0b001110: opXori(instruction); break;
-        case 0b001111: opLui(instruction); break;
-        case 0b000100: opBeq(instruction); break;
-        case 0b000101: opBne(instruction); break;
-        case 0b000110: opBlez(instruction); break;
-        case 0b000111: opBgtz(instruction); break;
-        case 0b010100: opBeql(instruction); break;
-        case 0b010101: opBnel(instruction); break;
-        case 0b010110: opBlezl(instruction); break;
-        case 0b010111: opBgtzl(instruction); break;
-        case 0b000010: opJ(instruction); break;
-        case 0b000011: opJal(instruction); break;
-        case 0b100000: opLb(instruction); break;
-        case 0b100001: opLh(instruction); break;
-        case 0b100010: opLwl(instruction); break;
-        case 0b100011: opLw(instruction); break;
-        case 0b100100: opLbu(instruction); break;
-        case 0b100101: opLhu(instruction); break;
-        case 0b100110: opLwr(instruction); break;
-        case 0b101000: opSb(instruction); break;
-        case 0b101001: opSh(instruction); break;
-        case 0b101010: opSwl(instruction); break;
-        case 0b101011: opSw(instruction); break;
-        case 0b101110: opSwr(instruction); break;
-        case 0b101111: opCache(instruction); break;
-
-        case 0b000001: { // Flow
-            u32 func = shift(instruction, 16, 5);
-            switch (func) {
-                case 0b00000: opBltz(instruction); break;
-                case 0b00001: opBgez(instruction); break;
-                case 0b10000: opBltzal(instruction); break;
-                case 0b10001: opBgezal(instruction); break;
-                default: assert(false);
+void Cpu::step() {
+    bool hasSlot = slot.pending;
+
+    u32 address = registers.pc;
+    u32 physical;
+
+    // only memory the page table reads directly can be cached, anything else decodes every time
+    if (memory.translate(address, physical)) {
+        u32 page = physical >> Memory::pageBits;
+        CachePage *entry = cache.find(page);
+
+        if (!entry || entry->stale) {
+            entry = &cache.create(page);
+
+            if (entry->stale) {
+                std::fill(std::begin(entry->instructions), std::end(entry->instructions), Instruction());
+                entry->stale = false;
             }
+
+            memory.watch(page);
+        }
+
+        Instruction &instruction = entry->instructions[(physical & Memory::pageMask) / sizeof(u32)];
+
+        // entries are never decoded to a null handler, so null marks one that hasn't been fetched
+        if (!instruction.handler)
+            instruction = decode(memory.get<u32>(address));
+
+        if (profiler)
+            profiler->step(instruction);
+
+        (this->*instruction.handler)(instruction);
+    } else {
+        Instruction instruction = decode(memory.get<u32>(address));
+
+        if (profiler)
+            profiler->step(instruction);
+
+        (this->*instruction.handler)(instruction);
+    }
+
+    // handlers write their destination unconditionally, $zero stays hardwired here instead
+    registers.regs[0] = 0;
+
+    registers.pc += sizeof(u32);
+    cycles++;
+
+    if (hasSlot) {
+        slot.pending = false;
+        registers.pc = slot.target;
+    }
+}
+
+Block *Cpu::compile(u32 address, u32 physical) {
+    std::unique_ptr<Block> block = std::make_unique<Block>();
+    block->start = physical;
+
+    bool delaySlot = false;
+
+    for (u32 a = 0; a < maxBlockSize; a++) {
+        u32 current = address + a * sizeof(u32);
+        u32 currentPhysical;
+
+        // stop where the mapping is no longer contiguous memory
+        if (!memory.translate(current, currentPhysical) || currentPhysical != physical + a * sizeof(u32))
             break;
+
+        u32 word = memory.get<u32>(current);
+
+        // eret moves the pc without a delay slot, step runs it on its own
+        if (word == eretWord)
+            break;
+
+        block->instructions.push_back(decode(word));
+        const Instruction &instruction = block->instructions.back();
+
+        if (delaySlot)
+            break;
+
+        delaySlot = instruction.branch;
+    }
+
+    if (block->instructions.empty())
+        return nullptr;
+
+    block->size = block->instructions.size() * sizeof(u32);
+
+    if (std::find(idle.addresses.begin(), idle.addresses.end(), address) != idle.addresses.end())
+        block->idle = IdleLoop::Forced;
+    else if (idle.detect && detectIdleLoop(block->instructions, address))
+        block->idle = IdleLoop::Detected;
+
+    if (block->idle != IdleLoop::None)
+        idleStats.loops++;
+
+    if (profiler)
+        block->profile = profiler->attach(physical, address, block->instructions);
+
+    for (u32 page = block->firstPage(); page <= block->lastPage(); page++)
+        memory.watch(page);
+
+    return &blocks.insert(std::move(block));
+}
+
+Block *Cpu::next(Block *previous) {
+    if (previous) {
+        Block *linked = blocks.follow(*previous, registers.pc);
+
+        if (linked) {
+            blocks.stats.hits++;
+            return linked;
         }
+    }
 
-        case 0b010000: { // COP0
-            u32 func = shift(instruction, 21, 5);
-            switch (func) {
-                case 0b00000: opMtc0(instruction); break;
-                case 0b00100: opMfc0(instruction); break;
-                default: assert(false);
-            }
+    u32 physical;
+    if (!memory.translate(registers.pc, physical))
+        return nullptr;
+
+    Block *block = blocks.find(physical);
+
+    if (block)
+        blocks.stats.hits++;
+    else
+        block = compile(registers.pc, physical);
+
+    if (block && previous)
+        blocks.link(*previous, *block, registers.pc);
+
+    return block;
+}
+
+void Cpu::run(const Block &block) {
+    u64 expected = registers.pc;
+
+    for (const Instruction &instruction : block.instructions) {
+        // a nullified delay slot moves the pc past the rest of the block
+        if (registers.pc != expected)
+            break;
+
+        bool hasSlot = slot.pending;
+
+        (this->*instruction.handler)(instruction);
+        registers.regs[0] = 0;
+
+        registers.pc += sizeof(u32);
+        expected += sizeof(u32);
+        cycles++;
+
+        if (hasSlot) {
+            slot.pending = false;
+            registers.pc = slot.target;
             break;
         }
+    }
+}
+
+bool Cpu::translate(Block &block) {
+    if (block.code || !block.translatable)
+        return block.code != nullptr;
+
+    block.code = recompiler->compile(block);
+
+    // out of space, start over and let blocks translate again as they run
+    if (!block.code && recompiler->full()) {
+        recompiler->reset();
+        blocks.dropCode();
+
+        block.code = recompiler->compile(block);
+    }
+
+    if (!block.code)
+        block.translatable = false;
+
+    return block.code != nullptr;
+}
+
+u32 Cpu::count() const {
+    return static_cast<u32>((cycles - cop0.countStart) >> 1);
+}
+
+void Cpu::scheduleCompare() {
+    u64 current = (cycles - cop0.countStart) >> 1;
+    u32 remaining = cop0.regs[Cop0::compare] - static_cast<u32>(current);
+
+    // equal now means the next match is a full wrap of Count away
+    u64 target = current + (remaining ? remaining : 1ull << 32);
+
+    scheduler.schedule(EventType::Compare, cop0.countStart + (target << 1));
+}
+
+void Cpu::scheduleStop() {
+    u64 target = Scheduler::never;
+
+    if (limits.cycles)
+        target = std::min(target, limits.cycles);
+
+    // skipped cycles don't count, so this is pushed back every time an idle loop fast-forwards into it
+    if (limits.instructions)
+        target = std::min(target, cycles + (limits.instructions - std::min(limits.instructions, executed())));
+
+    if (target != Scheduler::never)
+        scheduler.schedule(EventType::Stop, target);
+}
+
+void Cpu::scheduleRewind() {
+    if (history)
+        scheduler.schedule(EventType::Rewind, cycles + history->interval());
+}
+
+static EventType transferEvent(Device device) {
+    switch (device) {
+        case Device::Parallel: return EventType::ParallelDma;
+        case Device::Signal: return EventType::SignalDma;
+        default: assert(false);
+    }
+
+    return EventType::Stop;
+}
+
+void Cpu::scheduleTransfers() {
+    for (Device device : {Device::Parallel, Device::Signal}) {
+        if (u64 end = memory.transferEnd(device))
+            scheduler.schedule(transferEvent(device), end);
+        else
+            scheduler.cancel(transferEvent(device));
+    }
+}
+
+void Cpu::scheduleRsp() {
+    if (rsp->active())
+        scheduler.schedule(EventType::RspSync, cycles + rsp->interval());
+    else
+        scheduler.cancel(EventType::RspSync);
+}
+
+void Cpu::syncRsp() {
+    if (rsp->sync(cycles))
+        memory.breakSignal();
+
+    scheduleRsp();
+}
+
+void Cpu::dispatchEvents() {
+    EventType type;
+
+    while (scheduler.pop(cycles, type)) {
+        switch (type) {
+            case EventType::Compare:
+                cop0.regs[Cop0::cause] |= Cop0::timerInterrupt;
+                scheduleCompare();
+                checkInterrupts();
+                break;
+            case EventType::Stop:
+                if ((limits.cycles && cycles >= limits.cycles)
+                    || (limits.instructions && executed() >= limits.instructions))
+                    execute = false;
+                else
+                    scheduleStop();
+                break;
+            case EventType::Rewind:
+                history->push(snapshot());
+                scheduleRewind();
+                break;
+            case EventType::Yield:
+                paused = true;
+                break;
+            case EventType::ParallelDma:
+                memory.completeTransfer(Device::Parallel);
+                break;
+            case EventType::SignalDma:
+                memory.completeTransfer(Device::Signal);
+                break;
+            case EventType::RspSync:
+                syncRsp();
+                break;
+            case EventType::Interrupt:
+                checkInterrupts();
+                break;
+        }
+    }
+}
+
+void Cpu::checkInterrupts() {
+    u32 status = cop0.regs[Cop0::status];
+    u32 pending = cop0.regs[Cop0::cause] | (memory.interrupted() ? Cop0::rcpInterrupt : 0);
+
+    if (!(status & Cop0::interruptEnable) || (status & (Cop0::exceptionLevel | Cop0::errorLevel)))
+        return;
+
+    if (pending & status & Cop0::interruptMask)
+        exception(Cop0::interruptCode);
+}
+
+void Cpu::exception(u32 code) {
+    u32 &cause = cop0.regs[Cop0::cause];
+    cause = (cause & ~(Cop0::branchDelay | Cop0::exceptionCode)) | (code << 2);
 
-        default: {
-            assert(false);
+    // pc is the next instruction to run, with a branch pending that's its delay slot
+    if (slot.pending) {
+        cop0.regs[Cop0::epc] = static_cast<u32>(registers.pc - sizeof(u32));
+        cause |= Cop0::branchDelay;
+        slot.pending = false;
+    } else {
+        cop0.regs[Cop0::epc] = static_cast<u32>(registers.pc);
+    }
+
+    cop0.regs[Cop0::status] |= Cop0::exceptionLevel;
+    registers.pc = (cop0.regs[Cop0::status] & Cop0::bootVectors) ? 0xBFC00380 : 0x80000180;
+}
+
+u64 Cpu::nextEvent() const {
+    // devices that don't schedule their own events yet still get a look every frame
+    return std::min(scheduler.next(), cycles + maxIdleSkip);
+}
+
+bool Cpu::skipIdle(const Block &block) {
+    if (block.idle == IdleLoop::None || slot.pending)
+        return false;
+
+    // a load with side effects, or one whose value changes between events, makes every pass different
+    if (block.idle == IdleLoop::Detected) {
+        for (const Instruction &instruction : block.instructions) {
+            if (isIdleLoad(instruction.word)
+                && !memory.passive(static_cast<u32>(registers.regs[instruction.rs] + instruction.immediate)))
+                return false;
         }
     }
 
-    registers.pc += sizeof(instruction);
+    u64 target = nextEvent();
+
+    if (target <= cycles)
+        return false;
+
+    idleStats.skips++;
+    idleStats.cycles += target - cycles;
+    cycles = target;
+
+    return true;
+}
+
+void Cpu::delay(u64 target) {
+    slot.pending = true;
+    slot.target = target;
 }
 
-void Cpu::delay(const DelaySlot &slot) {
-    slots.push(slot);
+void Cpu::nullify() {
+    // branch likely not taken, skip over the delay slot
+    registers.pc += sizeof(u32);
 }
 
 void Cpu::exec() {
+    Block *previous = nullptr;
+
     while (execute) {
-        bool hasSlot = !slots.empty();
-        step();
-        if (hasSlot) {
-            slots.front()();
-            slots.pop();
+        // the only place time is checked, events land on block boundaries
+        if (cycles >= scheduler.next()) {
+            dispatchEvents();
+
+            if (!execute || paused)
+                break;
+        }
+
+        Block *block = next(previous);
+
+        if (!block) {
+            step();
+            previous = nullptr;
+            continue;
         }
+
+        // only once the loop has come around, so the registers hold what every pass computes,
+        // it still runs once after a skip to see whatever the event changed
+        if (block == previous)
+            skipIdle(*block);
+
+        if (profiler)
+            profiler->enter(block->profile);
+
+        // a block entered on a pending delay slot has to finish the branch, the interpreter handles that
+        if (recompiler && !slot.pending && translate(*block)) {
+            // charges what it ran on the way out
+            block->code();
+        } else {
+            run(*block);
+        }
+
+        previous = block->valid ? block : nullptr;
+        blocks.collect();
     }
 }
 
-Cpu::Cpu(const Rom &rom) : memory(rom) {
+bool Cpu::slice(u64 count) {
+    paused = false;
+    scheduler.schedule(EventType::Yield, cycles + count);
+
+    exec();
+
+    scheduler.cancel(EventType::Yield);
+
+    return execute;
+}
+
+void Cpu::report() const {
+    const BlockStats &stats = blocks.stats;
+    u64 lookups = stats.hits + stats.compiled;
+
+    fmt::print("Blocks: {} compiled, {} invalidated, {:.2f}% hit rate over {} lookups.\n",
+        stats.compiled, stats.invalidated, lookups ? stats.hits * 100.0 / lookups : 0.0, lookups);
+    fmt::print("Idle: {} loops found, {} cycles skipped in {} skips, {} cycles total.\n",
+        idleStats.loops, idleStats.cycles, idleStats.skips, cycles);
+
+    if (history)
+        fmt::print("Rewind: {} points in {:.1f} KiB.\n", history->size(), history->bytes() / 1024.0);
+
+    if (profiler)
+        profiler->write(memory.rom.header.pc, memory.rom.size());
+}
+
+#ifdef SCOUT_TRACE
+Cpu::Cpu(const Rom &rom, const CpuSettings &settings) : memory(rom), idle(settings.idle), limits(settings.limits), trace(settings.trace) {
+#else
+Cpu::Cpu(const Rom &rom, const CpuSettings &settings) : memory(rom), idle(settings.idle), limits(settings.limits) {
+#endif
     registers.regs[static_cast<u8>(RegisterIndex::Saved3)] = 0;
     registers.regs[static_cast<u8>(RegisterIndex::Saved4)] = 1;
     registers.regs[static_cast<u8>(RegisterIndex::Saved5)] = 0;
@@ -172,4 +635,44 @@ Cpu::Cpu(const Rom &rom) : memory(rom) {
     registers.pc = 0xA4000040;
     // PIFROM initializes SP to 0xA4001FF0 apparently
     registers.regs[static_cast<u8>(RegisterIndex::StackPointer)] = 0xA4001FF0;
-}
\ No newline at end of file
+
+    memory.watcher = [this](u32 page) { invalidate(page); };
+    memory.transfer = [this](Device device, u64 duration) {
+        // at least a cycle so completion is never seen by the instruction that started it
+        u64 end = cycles + std::max<u64>(duration, 1);
+        scheduler.schedule(transferEvent(device), end);
+        return end;
+    };
+
+    rsp = std::make_unique<Rsp>(settings.rsp);
+    memory.interruptRaised = [this]() {
+        scheduler.schedule(EventType::Interrupt, cycles);
+    };
+
+    memory.haltChanged = [this](bool halted) {
+        if (halted) {
+            rsp->halt(cycles);
+        } else {
+            rsp->start(cycles, memory.signalMemory() + kb(4));
+        }
+
+        scheduleRsp();
+    };
+
+    scheduleCompare();
+    scheduleStop();
+
+    if (settings.profile.enabled)
+        profiler = std::make_unique<Profiler>(settings.profile);
+
+    if (settings.rewind.capacity) {
+        history = std::make_unique<RewindBuffer>(settings.rewind);
+        scheduleRewind();
+    }
+
+    // traces are written by the handlers, so tracing keeps everything in the interpreter
+    if (settings.engine == CpuEngine::Recompiler && Recompiler::supported() && !settings.trace.enabled)
+        recompiler = std::make_unique<Recompiler>(*this, registers, slot, memory, cycles);
+}
+
+Cpu::~Cpu() = default;
\ No newline at end of file
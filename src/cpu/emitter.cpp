@@ -0,0 +1,237 @@
+#include <cpu/emitter.h>
+
+static u8 id(Host reg) {
+    return static_cast<u8>(reg);
+}
+
+void Emitter::byte(u8 value) {
+    code.push_back(value);
+}
+
+void Emitter::dword(u32 value) {
+    for (u32 a = 0; a < sizeof(u32); a++)
+        byte(value >> (a * 8));
+}
+
+void Emitter::qword(u64 value) {
+    for (u32 a = 0; a < sizeof(u64); a++)
+        byte(value >> (a * 8));
+}
+
+void Emitter::rex(bool wide, u8 reg, u8 index, u8 base, bool force) {
+    u8 value = 0x40 | (wide << 3) | ((reg >> 3) << 2) | ((index >> 3) << 1) | (base >> 3);
+
+    if (value != 0x40 || force)
+        byte(value);
+}
+
+void Emitter::encode(std::initializer_list<u8> opcode, u8 reg, Host rm, bool wide) {
+    rex(wide, reg, 0, id(rm));
+    for (u8 value : opcode)
+        byte(value);
+    byte(0xC0 | ((reg & 7) << 3) | (id(rm) & 7));
+}
+
+void Emitter::encode(std::initializer_list<u8> opcode, u8 reg, Host base, i32 offset, bool wide) {
+    rex(wide, reg, 0, id(base));
+    for (u8 value : opcode)
+        byte(value);
+
+    // always disp32, rsp and r12 need a sib byte
+    byte(0x80 | ((reg & 7) << 3) | (id(base) & 7));
+    if ((id(base) & 7) == 4)
+        byte(0x24);
+    dword(offset);
+}
+
+void Emitter::encode(std::initializer_list<u8> opcode, u8 reg, Host base, Host index, bool wide, bool force) {
+    assert(index != Host::Rsp);
+
+    rex(wide, reg, id(index), id(base), force);
+    for (u8 value : opcode)
+        byte(value);
+
+    // rbp and r13 can't be a base without a displacement
+    bool displacement = (id(base) & 7) == 5;
+
+    byte((displacement ? 0x44 : 0x04) | ((reg & 7) << 3));
+    byte(((id(index) & 7) << 3) | (id(base) & 7));
+    if (displacement)
+        byte(0);
+}
+
+void Emitter::mov(Host dest, Host src) {
+    encode({ 0x8B }, id(dest), src, true);
+}
+
+void Emitter::mov32(Host dest, Host src) {
+    encode({ 0x8B }, id(dest), src, false);
+}
+
+void Emitter::mov(Host dest, u64 value) {
+    if (value <= 0xFFFFFFFFu) {
+        rex(false, 0, 0, id(dest));
+        byte(0xB8 | (id(dest) & 7));
+        dword(value);
+    } else {
+        rex(true, 0, 0, id(dest));
+        byte(0xB8 | (id(dest) & 7));
+        qword(value);
+    }
+}
+
+void Emitter::load(Host dest, Host base, i32 offset) {
+    encode({ 0x8B }, id(dest), base, offset, true);
+}
+
+void Emitter::store(Host base, i32 offset, Host src) {
+    encode({ 0x89 }, id(src), base, offset, true);
+}
+
+void Emitter::store8(Host base, i32 offset, u8 value) {
+    encode({ 0xC6 }, 0, base, offset, false);
+    byte(value);
+}
+
+void Emitter::load8(Host dest, Host base, Host index) {
+    encode({ 0x0F, 0xB6 }, id(dest), base, index, false);
+}
+
+void Emitter::load16(Host dest, Host base, Host index) {
+    encode({ 0x0F, 0xB7 }, id(dest), base, index, false);
+}
+
+void Emitter::load32(Host dest, Host base, Host index) {
+    encode({ 0x8B }, id(dest), base, index, false);
+}
+
+void Emitter::store8(Host base, Host index, Host src) {
+    // rex keeps sil/dil from meaning dh/bh
+    encode({ 0x88 }, id(src), base, index, false, id(src) >= 4);
+}
+
+void Emitter::store16(Host base, Host index, Host src) {
+    byte(0x66);
+    encode({ 0x89 }, id(src), base, index, false);
+}
+
+void Emitter::store32(Host base, Host index, Host src) {
+    encode({ 0x89 }, id(src), base, index, false);
+}
+
+void Emitter::alu(Alu op, Host dest, Host src) {
+    encode({ static_cast<u8>(static_cast<u8>(op) * 8 + 3) }, id(dest), src, true);
+}
+
+void Emitter::alu(Alu op, Host dest, i32 value) {
+    encode({ 0x81 }, static_cast<u8>(op), dest, true);
+    dword(value);
+}
+
+void Emitter::alu32(Alu op, Host dest, i32 value) {
+    encode({ 0x81 }, static_cast<u8>(op), dest, false);
+    dword(value);
+}
+
+void Emitter::test(Host a, Host b) {
+    encode({ 0x85 }, id(b), a, true);
+}
+
+void Emitter::test32(Host a, i32 value) {
+    encode({ 0xF7 }, 0, a, false);
+    dword(value);
+}
+
+void Emitter::notq(Host dest) {
+    encode({ 0xF7 }, 2, dest, true);
+}
+
+void Emitter::shift(Shift op, Host dest, u8 count) {
+    encode({ 0xC1 }, static_cast<u8>(op), dest, true);
+    byte(count);
+}
+
+void Emitter::shift32(Shift op, Host dest, u8 count) {
+    encode({ 0xC1 }, static_cast<u8>(op), dest, false);
+    byte(count);
+}
+
+void Emitter::shiftCl(Shift op, Host dest) {
+    encode({ 0xD3 }, static_cast<u8>(op), dest, true);
+}
+
+void Emitter::imul(Host dest, Host src) {
+    encode({ 0x0F, 0xAF }, id(dest), src, true);
+}
+
+void Emitter::imul(Host dest, Host src, i32 value) {
+    encode({ 0x69 }, id(dest), src, true);
+    dword(value);
+}
+
+void Emitter::movsxd(Host dest, Host src) {
+    encode({ 0x63 }, id(dest), src, true);
+}
+
+void Emitter::bswap32(Host dest) {
+    rex(false, 0, 0, id(dest));
+    byte(0x0F);
+    byte(0xC8 | (id(dest) & 7));
+}
+
+void Emitter::set(Condition condition, Host dest) {
+    rex(false, 0, 0, id(dest), id(dest) >= 4);
+    byte(0x0F);
+    byte(0x90 | static_cast<u8>(condition));
+    byte(0xC0 | (id(dest) & 7));
+
+    // movzx dest32, dest8
+    encode({ 0x0F, 0xB6 }, id(dest), dest, false);
+}
+
+void Emitter::push(Host reg) {
+    rex(false, 0, 0, id(reg));
+    byte(0x50 | (id(reg) & 7));
+}
+
+void Emitter::pop(Host reg) {
+    rex(false, 0, 0, id(reg));
+    byte(0x58 | (id(reg) & 7));
+}
+
+void Emitter::call(const void *function) {
+    mov(Host::Rax, reinterpret_cast<u64>(function));
+    encode({ 0xFF }, 2, Host::Rax, false);
+}
+
+void Emitter::ret() {
+    byte(0xC3);
+}
+
+void Emitter::bind(Label &label) {
+    label.position = code.size();
+}
+
+void Emitter::jump(Label &label) {
+    byte(0xE9);
+    label.patches.push_back(code.size());
+    dword(0);
+}
+
+void Emitter::jump(Condition condition, Label &label) {
+    byte(0x0F);
+    byte(0x80 | static_cast<u8>(condition));
+    label.patches.push_back(code.size());
+    dword(0);
+}
+
+void Emitter::finish(Label &label) {
+    assert(label.position != ~ssi(0));
+
+    for (ssi patch : label.patches) {
+        u32 relative = static_cast<u32>(label.position - (patch + sizeof(u32)));
+        std::memcpy(&code[patch], &relative, sizeof(u32));
+    }
+
+    label.patches.clear();
+}
@@ -0,0 +1,128 @@
+#include <cpu/idle.h>
+
+// Registers read and written by one instruction, false if it has any other effect.
+static bool registerEffects(const Instruction &instruction, u32 &reads, u32 &writes) {
+    u32 rs = 1u << instruction.rs;
+    u32 rt = 1u << instruction.rt;
+    u32 rd = 1u << instruction.rd;
+
+    reads = 0;
+    writes = 0;
+
+    u32 op = shift(instruction.word, 26, 6);
+
+    switch (op) {
+        case 0b000000: {
+            u32 func = shift(instruction.word, 0, 6);
+
+            switch (func) {
+                case 0b000000: case 0b000010: case 0b000011: // sll, srl, sra
+                    reads = rt;
+                    writes = rd;
+                    return true;
+                case 0b000100: case 0b000110: case 0b000111: // sllv, srlv, srav
+                case 0b100000: case 0b100001: case 0b100010: case 0b100011: // add, addu, sub, subu
+                case 0b100100: case 0b100101: case 0b100110: case 0b100111: // and, or, xor, nor
+                case 0b101010: case 0b101011: // slt, sltu
+                    reads = rs | rt;
+                    writes = rd;
+                    return true;
+                case 0b010000: case 0b010010: // mfhi, mflo, hi and lo are never written in an idle loop
+                    writes = rd;
+                    return true;
+                default: // jr, jalr, syscall, break, hi/lo writes
+                    return false;
+            }
+        }
+
+        case 0b000001: // bltz, bgez, the linking forms write ra
+            reads = rs;
+            return !(instruction.rt & 0b10000);
+
+        case 0b000010: return true; // j
+
+        case 0b000100: case 0b000101: case 0b010100: case 0b010101: // beq, bne, beql, bnel
+            reads = rs | rt;
+            return true;
+
+        case 0b000110: case 0b000111: case 0b010110: case 0b010111: // blez, bgtz, blezl, bgtzl
+            reads = rs;
+            return true;
+
+        case 0b001111: // lui
+            writes = rt;
+            return true;
+
+        case 0b100010: case 0b100110: // lwl, lwr merge into rt
+            reads = rs | rt;
+            writes = rt;
+            return true;
+
+        default: break;
+    }
+
+    if ((op >= 0b001000 && op <= 0b001110) || isIdleLoad(instruction.word)) {
+        reads = rs;
+        writes = rt;
+        return true;
+    }
+
+    return false;
+}
+
+bool isIdleLoad(u32 instruction) {
+    u32 op = shift(instruction, 26, 6);
+
+    return op >= 0b100000 && op <= 0b100110;
+}
+
+bool detectIdleLoop(const std::vector<Instruction> &instructions, u32 address) {
+    // the block ends on a branch and its delay slot
+    if (instructions.size() < 2 || !instructions[instructions.size() - 2].branch || instructions.back().branch)
+        return false;
+
+    u32 index = instructions.size() - 2;
+    const Instruction &branch = instructions[index];
+
+    u32 op = shift(branch.word, 26, 6);
+    u32 pc = address + index * sizeof(u32);
+
+    // jr and jalr could come back around too, but not in a way that is known before running
+    if (op == 0b000000)
+        return false;
+
+    if (op == 0b000010) {
+        if ((((pc + sizeof(u32)) & 0xF0000000) | (shift(branch.word, 0, 26) * sizeof(u32))) != address)
+            return false;
+    } else if (static_cast<i32>(index) + 1 + branch.immediate != 0) {
+        return false;
+    }
+
+    u32 reads;
+    u32 writes;
+    u32 written = 0;
+
+    for (const Instruction &instruction : instructions) {
+        if (!registerEffects(instruction, reads, writes))
+            return false;
+
+        written |= writes;
+    }
+
+    // r0 never changes, every engine puts it back to zero after each instruction
+    written &= ~1u;
+
+    u32 current = 0;
+
+    for (const Instruction &instruction : instructions) {
+        registerEffects(instruction, reads, writes);
+
+        // a value carried over from the last pass makes this one different
+        if (reads & written & ~current)
+            return false;
+
+        current |= writes;
+    }
+
+    return true;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cpu/cache.h>
+#include <cpu/idle.h>
+
+#include <unordered_map>
+
+class Block;
+class BlockProfile;
+
+// Cached successor of a block, only followed while the cache epoch it was made in is current.
+class BlockLink {
+public:
+    Block *block = nullptr;
+    u64 pc = 0;
+    u64 epoch = 0;
+};
+
+// Straight-line run of decoded instructions ending after a branch and its delay slot.
+class Block {
+public:
+    typedef void (*Code)();
+
+    u32 start = 0; // physical address of the first instruction
+    u32 size = 0; // bytes
+    bool valid = true;
+
+    // branches back to its own start without changing anything, see detectIdleLoop
+    IdleLoop idle = IdleLoop::None;
+
+    // only set while profiling
+    BlockProfile *profile = nullptr;
+
+    // native translation when the recompiler is enabled
+    Code code = nullptr;
+    bool translatable = true;
+
+    std::vector<Instruction> instructions;
+    BlockLink links[2];
+
+    u32 firstPage() const { return start >> Memory::pageBits; }
+    u32 lastPage() const { return (start + size - 1) >> Memory::pageBits; }
+};
+
+class BlockStats {
+public:
+    u64 hits = 0;
+    u64 compiled = 0;
+    u64 invalidated = 0;
+};
+
+class BlockCache {
+    std::unordered_map<u32, std::unique_ptr<Block>> blocks;
+    std::unordered_map<u32, std::vector<Block *>> pages;
+
+    // invalidated blocks might still be running, they are freed by collect
+    std::vector<std::unique_ptr<Block>> retired;
+
+public:
+    // bumped on every invalidation so no link can point at a retired block
+    u64 epoch = 0;
+    BlockStats stats;
+
+    Block *find(u32 start);
+    Block &insert(std::unique_ptr<Block> block);
+
+    void link(Block &from, Block &to, u64 pc);
+    Block *follow(const Block &from, u64 pc) const;
+
+    void invalidate(u32 page);
+    void collect();
+
+    // forgets every native translation, used when the code buffer is reset
+    void dropCode();
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cpu/memory.h>
+
+class Cpu;
+
+// Decoded form of one instruction word, fields are extracted once when the word is first executed.
+class Instruction {
+public:
+    typedef void (Cpu::*Handler)(const Instruction &instruction);
+
+    Handler handler = nullptr;
+    u32 word = 0;
+
+    // branch or jump, the next instruction is its delay slot
+    bool branch = false;
+
+    u8 rs = 0;
+    u8 rt = 0;
+    u8 rd = 0;
+    u8 sa = 0;
+
+    // dispatch table slot, names the instruction for the profiler
+    u16 opcode = 0;
+
+    // sign extended, handlers that want the zero extended form truncate to u16
+    i32 immediate = 0;
+};
+
+class CachePage {
+public:
+    // set when the backing memory was written, the page is reset on its next fetch
+    bool stale = false;
+
+    Instruction instructions[Memory::pageSize / sizeof(u32)];
+};
+
+// Decoded instructions indexed by physical address, pages are allocated on first execution.
+class InstructionCache {
+    std::vector<std::unique_ptr<CachePage>> pages;
+
+public:
+    CachePage *find(u32 page) {
+        return page < pages.size() ? pages[page].get() : nullptr;
+    }
+
+    CachePage &create(u32 page);
+    void invalidate(u32 page);
+
+    InstructionCache();
+};
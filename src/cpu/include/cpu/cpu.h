@@ -1,8 +1,10 @@
 #pragma once
 
 #include <cpu/memory.h>
-
-#include <queue>
+#include <cpu/block.h>
+#include <cpu/recompiler.h>
+#include <cpu/settings.h>
+#include <cpu/scheduler.h>
 
 enum class RegisterIndex : u8 {
     Zero,
@@ -51,99 +53,255 @@ public:
     u64 llb = 0;
 };
 
-typedef std::function<void()> DelaySlot;
+// Branch taken by the previous instruction, applied once its delay slot has executed.
+class DelaySlot {
+public:
+    bool pending = false;
+    u64 target = 0;
+};
+
+// System control coprocessor. Count isn't stored, it is derived from Cpu::cycles through countStart.
+class Cop0 {
+public:
+    static constexpr u8 count = 9;
+    static constexpr u8 compare = 11;
+    static constexpr u8 status = 12;
+    static constexpr u8 cause = 13;
+    static constexpr u8 epc = 14;
+    static constexpr u8 errorEpc = 30;
+
+    // Status bits
+    static constexpr u32 interruptEnable = 1u << 0;
+    static constexpr u32 exceptionLevel = 1u << 1;
+    static constexpr u32 errorLevel = 1u << 2;
+    static constexpr u32 interruptMask = 0xFFu << 8; // lines up with the Cause IP bits
+    static constexpr u32 bootVectors = 1u << 22;
+
+    // Cause bits besides the interrupts
+    static constexpr u32 branchDelay = 1u << 31;
+    static constexpr u32 exceptionCode = 0x1Fu << 2;
+    static constexpr u32 interruptCode = 0;
+
+    // Cause IP7, raised when Count reaches Compare
+    static constexpr u32 timerInterrupt = 1u << 15;
+    // Cause IP2, the MI interrupt line, read from Memory rather than stored
+    static constexpr u32 rcpInterrupt = 1u << 10;
+    // Cause IP0 and IP1, the only bits software writes
+    static constexpr u32 softwareInterrupts = 0b11u << 8;
+
+    u32 regs[32] = {0};
+
+    // cycle at which Count was last zero, Count ticks every other cycle
+    u64 countStart = 0;
+};
+
+// Handlers for every encoding, filled in at compile time by Cpu::dispatchTable.
+// Level 0 is indexed by primary opcode, levels 1-3 by the SPECIAL funct, REGIMM rt and COP0 rs fields.
+class DispatchTable {
+public:
+    static constexpr u32 levels = 4;
+    static constexpr u32 entries = 64;
+
+    // per primary opcode in one word, so a lookup is one load per level: the first handler of its
+    // level in the top half, then the mask and shift that pick its index field out of the word
+    u32 routes[entries] = {};
+
+    Instruction::Handler handlers[levels * entries] = {};
+    const char *names[levels * entries] = {};
+
+    constexpr void route(u32 op, u32 table, u32 offset, u32 bits) {
+        routes[op] = (table * entries) << 16 | ((1u << bits) - 1) << 8 | offset;
+    }
+
+    constexpr void set(u32 table, u32 index, Instruction::Handler handler, const char *name) {
+        handlers[table * entries + index] = handler;
+        names[table * entries + index] = name;
+    }
+};
+
+class Snapshot;
+class RewindBuffer;
+class Rsp;
 
 class Cpu {
     Registers registers;
     Memory memory;
 
-    std::queue<DelaySlot> slots;
+    DelaySlot slot;
+    Cop0 cop0;
+    InstructionCache cache;
+    BlockCache blocks;
+
+    // null unless the recompiler was requested and the host supports it
+    std::unique_ptr<Recompiler> recompiler;
+
+    // guest time, one cycle per instruction executed
+    u64 cycles = 0;
+    Scheduler scheduler;
 
-    static void unimplemented(const std::string &name, u32 instruction);
+    IdleSettings idle;
+    IdleStats idleStats;
 
-    void delay(const DelaySlot &slot);
+    RunLimits limits;
+
+#ifdef SCOUT_TRACE
+    Trace trace;
+#endif
+
+    // null unless profiling was requested
+    std::unique_ptr<Profiler> profiler;
+    std::unique_ptr<RewindBuffer> history;
+    std::unique_ptr<Rsp> rsp;
+
+    // name has to be a string literal
+    void unimplemented(const char *name, u32 instruction);
+
+    void delay(u64 target);
+    void nullify();
 
     // ALU
-    void opAdd(u32 instruction);
-    void opAddu(u32 instruction);
-    void opSub(u32 instruction);
-    void opSubu(u32 instruction);
-    void opMult(u32 instruction);
-    void opMultu(u32 instruction);
-    void opDiv(u32 instruction);
-    void opDivu(u32 instruction);
-    void opMfhi(u32 instruction);
-    void opMthi(u32 instruction);
-    void opMflo(u32 instruction);
-    void opMtlo(u32 instruction);
-    void opSll(u32 instruction);
-    void opSrl(u32 instruction);
-    void opSra(u32 instruction);
-    void opSllv(u32 instruction);
-    void opSrlv(u32 instruction);
-    void opSrav(u32 instruction);
-    void opSlt(u32 instruction);
-    void opSltu(u32 instruction);
-    void opAnd(u32 instruction);
-    void opOr(u32 instruction);
-    void opXor(u32 instruction);
-    void opNor(u32 instruction);
-    void opSyscall(u32 instruction);
-    void opBreak(u32 instruction);
+    void opAdd(const Instruction &instruction);
+    void opAddu(const Instruction &instruction);
+    void opSub(const Instruction &instruction);
+    void opSubu(const Instruction &instruction);
+    void opMult(const Instruction &instruction);
+    void opMultu(const Instruction &instruction);
+    void opDiv(const Instruction &instruction);
+    void opDivu(const Instruction &instruction);
+    void opMfhi(const Instruction &instruction);
+    void opMthi(const Instruction &instruction);
+    void opMflo(const Instruction &instruction);
+    void opMtlo(const Instruction &instruction);
+    void opSll(const Instruction &instruction);
+    void opSrl(const Instruction &instruction);
+    void opSra(const Instruction &instruction);
+    void opSllv(const Instruction &instruction);
+    void opSrlv(const Instruction &instruction);
+    void opSrav(const Instruction &instruction);
+    void opSlt(const Instruction &instruction);
+    void opSltu(const Instruction &instruction);
+    void opAnd(const Instruction &instruction);
+    void opOr(const Instruction &instruction);
+    void opXor(const Instruction &instruction);
+    void opNor(const Instruction &instruction);
+    void opSyscall(const Instruction &instruction);
+    void opBreak(const Instruction &instruction);
 
     // Immediate
-    void opAddi(u32 instruction);
-    void opAddiu(u32 instruction);
-    void opSlti(u32 instruction);
-    void opSltiu(u32 instruction);
-    void opAndi(u32 instruction);
-    void opOri(u32 instruction);
-    void opXori(u32 instruction);
-    void opLui(u32 instruction);
+    void opAddi(const Instruction &instruction);
+    void opAddiu(const Instruction &instruction);
+    void opSlti(const Instruction &instruction);
+    void opSltiu(const Instruction &instruction);
+    void opAndi(const Instruction &instruction);
+    void opOri(const Instruction &instruction);
+    void opXori(const Instruction &instruction);
+    void opLui(const Instruction &instruction);
 
     // Flow
-    void opBeq(u32 instruction);
-    void opBne(u32 instruction);
-    void opBlez(u32 instruction);
-    void opBgtz(u32 instruction);
-    void opBltz(u32 instruction);
-    void opBgez(u32 instruction);
-    void opBltzal(u32 instruction);
-    void opBgezal(u32 instruction);
-    void opBeql(u32 instruction);
-    void opBnel(u32 instruction);
-    void opBlezl(u32 instruction);
-    void opBgtzl(u32 instruction);
-    void opJ(u32 instruction);
-    void opJal(u32 instruction);
-    void opJr(u32 instruction);
-    void opJalr(u32 instruction);
-    void opCache(u32 instruction);
+    void opBeq(const Instruction &instruction);
+    void opBne(const Instruction &instruction);
+    void opBlez(const Instruction &instruction);
+    void opBgtz(const Instruction &instruction);
+    void opBltz(const Instruction &instruction);
+    void opBgez(const Instruction &instruction);
+    void opBltzal(const Instruction &instruction);
+    void opBgezal(const Instruction &instruction);
+    void opBeql(const Instruction &instruction);
+    void opBnel(const Instruction &instruction);
+    void opBlezl(const Instruction &instruction);
+    void opBgtzl(const Instruction &instruction);
+    void opJ(const Instruction &instruction);
+    void opJal(const Instruction &instruction);
+    void opJr(const Instruction &instruction);
+    void opJalr(const Instruction &instruction);
+    void opCache(const Instruction &instruction);
 
     // Data
-    void opLb(u32 instruction);
-    void opLh(u32 instruction);
-    void opLwl(u32 instruction);
-    void opLw(u32 instruction);
-    void opLbu(u32 instruction);
-    void opLhu(u32 instruction);
-    void opLwr(u32 instruction);
-    void opSb(u32 instruction);
-    void opSh(u32 instruction);
-    void opSwl(u32 instruction);
-    void opSw(u32 instruction);
-    void opSwr(u32 instruction);
+    void opLb(const Instruction &instruction);
+    void opLh(const Instruction &instruction);
+    void opLwl(const Instruction &instruction);
+    void opLw(const Instruction &instruction);
+    void opLbu(const Instruction &instruction);
+    void opLhu(const Instruction &instruction);
+    void opLwr(const Instruction &instruction);
+    void opSb(const Instruction &instruction);
+    void opSh(const Instruction &instruction);
+    void opSwl(const Instruction &instruction);
+    void opSw(const Instruction &instruction);
+    void opSwr(const Instruction &instruction);
 
     // COP 0
-    void opMtc0(u32 instruction);
-    void opMfc0(u32 instruction);
+    void opMtc0(const Instruction &instruction);
+    void opMfc0(const Instruction &instruction);
+    void opEret(const Instruction &instruction);
 
-    void step();
+    // any encoding without a handler above
+    void opReserved(const Instruction &instruction);
+
+    static constexpr DispatchTable dispatchTable();
+    static const DispatchTable &dispatch();
+    static u16 opcode(u32 instruction);
+    static bool isBranch(u32 instruction);
+    static Instruction decode(u32 word);
+
+    void invalidate(u32 page);
+
+    static constexpr u32 maxBlockSize = 64;
+    static constexpr u32 eretWord = 0x42000018;
+
+    Block *compile(u32 address, u32 physical);
+    Block *next(Block *previous);
+    void run(const Block &block);
+    bool translate(Block &block);
+
+    // one NTSC frame at 93.75 MHz
+    static constexpr u64 maxIdleSkip = 1562500;
+
+    u32 count() const;
+    void scheduleCompare();
+    void scheduleStop();
+    void scheduleRewind();
+    // reschedules DMA already in flight in memory, after a restore
+    void scheduleTransfers();
+    void scheduleRsp();
+    void syncRsp();
+    void dispatchEvents();
+
+    // Takes an interrupt if one is pending, enabled and unmasked. Only between instructions.
+    void checkInterrupts();
+    void exception(u32 code);
+
+    u64 nextEvent() const;
+    bool skipIdle(const Block &block);
+
+    // set by a Yield event, exec returns without stopping the cpu
+    bool paused = false;
 
 public:
     volatile bool execute = true;
 
     void exec();
+    // Runs about cycles guest cycles, to the next block boundary, false once the cpu has stopped for good.
+    bool slice(u64 cycles);
+    void report() const;
+
+    static const char *opcodeName(u16 opcode);
+
+    // executes the instruction at pc outside of any block, exec falls back to it where blocks can't be built
+    void step();
+
+    // instructions actually run, cycles also counts the ones idle loops skipped
+    u64 executed() const { return cycles - idleStats.cycles; }
+    u64 elapsed() const { return cycles; }
+
+    // Copies the machine state, or returns to one. Whatever was left of the run limits carries over.
+    Snapshot snapshot();
+    void restore(const Snapshot &snapshot);
+
+    // Returns to the rewind point that many points before the current state, or the oldest one kept.
+    // Points after it are forgotten. False without any history to go back to.
+    bool rewind(u32 points);
 
-    explicit Cpu(const Rom &rom);
+    Cpu(const Rom &rom, const CpuSettings &settings);
+    ~Cpu();
 };
\ No newline at end of file
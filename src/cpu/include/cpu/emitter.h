@@ -0,0 +1,98 @@
+#pragma once
+
+#include <util/util.h>
+
+#include <initializer_list>
+
+enum class Host : u8 {
+    Rax, Rcx, Rdx, Rbx, Rsp, Rbp, Rsi, Rdi,
+    R8, R9, R10, R11, R12, R13, R14, R15,
+};
+
+enum class Condition : u8 {
+    Below = 0x2,
+    AboveEqual = 0x3,
+    Equal = 0x4,
+    NotEqual = 0x5,
+    Less = 0xC,
+    GreaterEqual = 0xD,
+    LessEqual = 0xE,
+    Greater = 0xF,
+};
+
+enum class Alu : u8 {
+    Add = 0,
+    Or = 1,
+    And = 4,
+    Sub = 5,
+    Xor = 6,
+    Cmp = 7,
+};
+
+enum class Shift : u8 {
+    Left = 4,
+    Right = 5,
+    Arithmetic = 7,
+};
+
+class Label {
+public:
+    ssi position = ~ssi(0);
+    std::vector<ssi> patches;
+};
+
+// Minimal x86-64 encoder, only what the recompiler emits. Operands are 64-bit unless a name says otherwise.
+class Emitter {
+    void byte(u8 value);
+    void dword(u32 value);
+    void qword(u64 value);
+
+    void rex(bool wide, u8 reg, u8 index, u8 base, bool force = false);
+
+    void encode(std::initializer_list<u8> opcode, u8 reg, Host rm, bool wide);
+    void encode(std::initializer_list<u8> opcode, u8 reg, Host base, i32 offset, bool wide);
+    void encode(std::initializer_list<u8> opcode, u8 reg, Host base, Host index, bool wide, bool force = false);
+
+public:
+    std::vector<u8> code;
+
+    void mov(Host dest, Host src);
+    void mov32(Host dest, Host src); // zero extends
+    void mov(Host dest, u64 value);
+    void load(Host dest, Host base, i32 offset);
+    void store(Host base, i32 offset, Host src);
+    void store8(Host base, i32 offset, u8 value);
+
+    // [base + index] accesses, loads zero extend into the full register
+    void load8(Host dest, Host base, Host index);
+    void load16(Host dest, Host base, Host index);
+    void load32(Host dest, Host base, Host index);
+    void store8(Host base, Host index, Host src);
+    void store16(Host base, Host index, Host src);
+    void store32(Host base, Host index, Host src);
+
+    void alu(Alu op, Host dest, Host src);
+    void alu(Alu op, Host dest, i32 value);
+    void alu32(Alu op, Host dest, i32 value);
+    void test(Host a, Host b);
+    void test32(Host a, i32 value);
+    void notq(Host dest);
+    void shift(Shift op, Host dest, u8 count);
+    void shift32(Shift op, Host dest, u8 count);
+    void shiftCl(Shift op, Host dest);
+    void imul(Host dest, Host src);
+    void imul(Host dest, Host src, i32 value);
+    void movsxd(Host dest, Host src);
+    void bswap32(Host dest);
+    void set(Condition condition, Host dest); // dest = condition ? 1 : 0
+
+    void push(Host reg);
+    void pop(Host reg);
+    void call(const void *function);
+    void ret();
+
+    void bind(Label &label);
+    void jump(Label &label);
+    void jump(Condition condition, Label &label);
+    void finish(Label &label);
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cpu/cache.h>
+
+enum class IdleLoop : u8 {
+    None,
+    Detected, // proven idle, still checks its loads are passive before skipping
+    Forced, // listed in IdleSettings, trusted as is
+};
+
+class IdleSettings {
+public:
+    bool detect = true;
+
+    // virtual addresses of loops to treat as idle regardless of detection
+    std::vector<u32> addresses;
+};
+
+class IdleStats {
+public:
+    u64 loops = 0;
+    u64 skips = 0;
+    u64 cycles = 0;
+};
+
+// True for loads, the only memory access an idle loop may make.
+bool isIdleLoad(u32 instruction);
+
+// Whether running a block that starts at address again can only repeat what it just did.
+// It must branch back to its own start, make no stores or coprocessor/hi/lo writes,
+// and every register it reads must either be left alone by the loop or written earlier in the same pass.
+bool detectIdleLoop(const std::vector<Instruction> &instructions, u32 address);
@@ -3,10 +3,28 @@
 #include <rom/rom.h>
 #include <cpu/options.h>
 
+#include <array>
 #include <functional>
+#include <memory>
 
-typedef std::function<u8(u32)> MemoryRead;
-typedef std::function<void(u32, u8)> MemoryWrite;
+typedef std::function<void(u32)> MemoryWatch;
+
+// Register blocks with side effects, indexes Memory's handler table.
+enum class Device : u8 {
+    RamRegisters,
+    Signal,
+    Mips,
+    RamInterface,
+    Parallel,
+    Count,
+};
+
+// Asked to time a DMA the device just started, returns the guest cycle it finishes at.
+typedef std::function<u64(Device device, u64 duration)> MemoryTransfer;
+// Told whenever a status write starts or halts the RSP.
+typedef std::function<void(bool halted)> MemoryHalt;
+// Told when interrupted() goes from false to true.
+typedef std::function<void()> MemoryInterrupt;
 
 class MemoryRegion {
 public:
@@ -23,17 +41,14 @@ public:
         Dummy,
         ReadWriteData,
         ReadOnlyData,
-        ReadWriteDevice,
-        ReadOnlyDevice,
-        WriteOnlyDevice,
+        Device,
         Mirror,
     };
 
     Type type;
 
     u8 *data = nullptr;
-    MemoryRead readDevice;
-    MemoryWrite writeDevice;
+    Device device = Device::Count;
     u32 mirrorStart = 0;
 
     bool supports(Intention intention) const;
@@ -42,22 +57,116 @@ public:
     MemoryRegion(u32 start, u32 size);
     MemoryRegion(u32 start, u32 size, void *data);
     MemoryRegion(u32 start, u32 size, const void *data);
-    MemoryRegion(u32 start, u32 size, MemoryRead device);
-    MemoryRegion(u32 start, u32 size, MemoryWrite device);
-    MemoryRegion(u32 start, u32 size, MemoryRead read, MemoryWrite write);
+    MemoryRegion(u32 start, u32 size, Device device);
     MemoryRegion(u32 start, u32 size, u32 mirrorStart);
 };
 
 u8 unimplementedRead(u32 address);
 void unimplementedWrite(u32 address, u8 value);
 
+// One entry per 4 KiB page of the 32-bit address space, mirrors are resolved when the table is built.
+class MemoryPage {
+public:
+    // host pointers to the start of the page, nullptr when the access must take the slow path
+    u8 *read;
+    u8 *write;
+
+    // page start after resolving mirrors
+    u32 address;
+
+    // regions index + 1 of the region covering the whole page, noSlot or splitSlot otherwise
+    u16 readSlot;
+    u16 writeSlot;
+};
+
+// contents of one Memory page
+typedef std::array<u8, 4096> PageData;
+
+class MemoryState;
+
 class Memory {
     std::vector<MemoryRegion> regions;
-    MemoryRegion findRegion(u32 address, MemoryRegion::Intention intention);
+    const MemoryRegion *findRegion(u32 address, MemoryRegion::Intention intention) const;
+    const MemoryRegion *resolveRegion(u32 &address, MemoryRegion::Intention intention) const;
+
+    std::unique_ptr<MemoryPage[], void (*)(void *)> pages;
+    u16 resolvePage(u32 &address, MemoryRegion::Intention intention) const;
+    void buildPages();
+
+    const MemoryRegion *pageRegion(u16 slot, u32 &address, MemoryRegion::Intention intention) const;
+
+    std::vector<bool> watched;
+    void setWritable(u32 page, bool writable);
+    void release(u32 address);
+
+    // pages still holding their contents in base, write protected so the first write clears this
+    std::vector<bool> clean;
+    std::vector<std::shared_ptr<const PageData>> base;
+
+    u32 statePhysical(u32 index) const;
+    u8 *stateData(u32 index);
+    void protect(u32 page);
+
+    u8 *resolveData(u32 address, ssi size, MemoryRegion::Intention intention);
+
+    u8 getByteSlow(u32 address);
+    void setByteSlow(u32 address, u8 value);
+
+    // Device registers are handled a word at a time, value holds the register index.
+    class DeviceHandlers {
+    public:
+        u32 (Memory::*read)(u32 index);
+        void (Memory::*write)(u32 index, u32 value, u32 mask);
+    };
+
+    static const DeviceHandlers devices[static_cast<ssi>(Device::Count)];
+
+    // Accesses of 1, 2 or 4 bytes within one register or 8 bytes across an aligned pair, false for anything else.
+    bool readDevice(u32 address, ssi size, u64 &value);
+    bool writeDevice(u32 address, ssi size, u64 value);
+
+    u32 readRamRegisters(u32 index);
+    void writeRamRegisters(u32 index, u32 value, u32 mask);
+    u32 readSignal(u32 index);
+    void writeSignal(u32 index, u32 value, u32 mask);
+    u32 readMips(u32 index);
+    void writeMips(u32 index, u32 value, u32 mask);
+    u32 readRamInterface(u32 index);
+    void writeRamInterface(u32 index, u32 value, u32 mask);
+    u32 readParallel(u32 index);
+    void writeParallel(u32 index, u32 value, u32 mask);
+
+    // guest cycle the DMA in flight on each device finishes at, zero when idle
+    std::array<u64, static_cast<ssi>(Device::Count)> transferEnds = {};
+    void beginTransfer(Device device, u64 duration);
+
+    // the SP DMA waiting behind the one in flight, only meaningful while the SP is full
+    SignalDma signalQueued;
+
+    void startSignal(bool toRam);
+    void runSignal(const SignalDma &request);
+    void copySignalRow(u32 dram, u32 mem, u32 size, bool toRam);
+
+    // Every register block, PIF RAM and DMA field the state keeps, in the order it stores them.
+    template <typename Visit>
+    static void visitRegisters(MipsInterface &mips, RamRegisters &ramRegisters, RamInterface &ramInterface,
+        SignalRegisters &sp, ParallelInterface &pi, std::array<u8, 64> &pif,
+        std::array<u64, static_cast<ssi>(Device::Count)> &ends, SignalDma &queued, Visit &visit);
+    template <typename Visit>
+    void visitRegisters(Visit &visit);
+
+    // calls interruptRaised if the line is up now, for callers that saw it down before their change
+    void notifyInterrupt();
+
+    void startParallel(bool toCart);
+    u64 parallelCycles(u32 length) const;
 
     std::vector<u8> ram;
     std::vector<u8> spMemory;
 
+    // plain memory for now, nothing answers the joybus commands games leave in it
+    std::array<u8, 64> pifRam = {};
+
     MipsInterface mipsInterface;
     RamRegisters ramRegisters;
     RamInterface ramInterface;
@@ -65,21 +174,127 @@ class Memory {
     ParallelInterface parallelInterface;
 
 public:
-    u8 getByte(u32 address);
-    void setByte(u32 address, u8 value);
+    static constexpr u32 pageBits = 12;
+    static constexpr u32 pageSize = 1u << pageBits;
+    static constexpr u32 pageMask = pageSize - 1;
+    static constexpr u32 pageCount = 1u << (32 - pageBits);
+
+    static constexpr ssi ramSize = mb(4);
+    static constexpr ssi spMemorySize = kb(8);
+    // cartridge domain 1, where the image is seen by the PI
+    static constexpr u32 romStart = 0x10000000;
+    // the cart window ends where the PIF begins
+    static constexpr u32 romLimit = 0x0FC00000;
+    static constexpr u32 pifRamStart = 0x1FC007C0;
+    // RCP cycles an SP DMA spends on each row besides moving the data
+    static constexpr u64 signalRowSetup = 8;
+
+    static constexpr u16 noSlot = 0;
+    static constexpr u16 splitSlot = 0xFFFF;
+
+    // called with the physical page index the first time a watched page is written
+    MemoryWatch watcher;
+
+    // Write protects a physical page through every mirror until it is next written.
+    void watch(u32 page);
+
+    // times DMA completion, without it transfers finish instantly
+    MemoryTransfer transfer;
+
+    u64 transferEnd(Device device) const { return transferEnds[static_cast<ssi>(device)]; }
+    // Called once the guest reaches transferEnd, raises the device's interrupt.
+    void completeTransfer(Device device);
+
+    // starts and stops the RSP, without it status writes only change the register
+    MemoryHalt haltChanged;
 
+    bool rspHalted() const { return (signalRegisters.statusRegister & SignalRegisters::halt) != 0; }
+    // The running RSP task hit a break, halts it and interrupts if asked to.
+    void breakSignal();
+
+    // DMEM followed by IMEM
+    const u8 *signalMemory() const { return spMemory.data(); }
+
+    // MI interrupts the mask lets through, wired to Cause IP2
+    bool interrupted() const { return (mipsInterface.interrupt & mipsInterface.interruptMask) != 0; }
+    MemoryInterrupt interruptRaised;
+
+    // True if reading address can't change anything and sees the same value until the next store or
+    // scheduled event, plain data or a device register without read side effects.
+    bool passive(u32 address) const;
+
+    // Shares every RDRAM and SP memory page unchanged since the last capture or restore, copies the rest.
+    MemoryState capture();
+    // Copies back only the pages that differ from state, dropping any code decoded from them.
+    void restore(const MemoryState &state);
+
+    // sizes of MemoryState::pages and MemoryState::registers
+    static u32 statePages();
+    static ssi registerBytes();
+
+    // base of the page table, indexed by address >> pageBits
+    const MemoryPage *pageTable() const { return pages.get(); }
+
+    // Resolves address to its physical address if it is backed by directly readable memory.
+    bool translate(u32 address, u32 &physical) const {
+        const MemoryPage &page = pages[address >> pageBits];
+
+        if (!page.read)
+            return false;
+
+        physical = page.address | (address & pageMask);
+        return true;
+    }
+
+    u8 getByte(u32 address) {
+        const MemoryPage &page = pages[address >> pageBits];
+
+        if (page.read)
+            return page.read[address & pageMask];
+
+        return getByteSlow(address);
+    }
+
+    void setByte(u32 address, u8 value) {
+        const MemoryPage &page = pages[address >> pageBits];
+
+        if (page.write)
+            page.write[address & pageMask] = value;
+        else
+            setByteSlow(address, value);
+    }
+
+    // Aligned data accesses resolve the page once and swap with a single host load, device registers
+    // take one handler call per word, anything straddling regions goes byte by byte.
     template <typename T>
     T get(u32 address) {
         constexpr ssi size = sizeof(T);
 
+        const MemoryPage &page = pages[address >> pageBits];
+        u32 offset = address & pageMask;
+
         T result = 0;
 
+        if (page.read && offset <= pageSize - size) {
+            std::memcpy(&result, page.read + offset, size);
+            return swap(result);
+        }
+
+        if (const u8 *data = resolveData(address, size, MemoryRegion::Intention::Read)) {
+            std::memcpy(&result, data, size);
+            return swap(result);
+        }
+
+        u64 value;
+
+        if (readDevice(address, size, value))
+            return static_cast<T>(value);
+
         for (ssi a = 0; a < size; a++) {
             result <<= 8;
             result |= getByte(address + a);
         }
 
-        // might need swap
         return result;
     }
 
@@ -87,6 +302,24 @@ public:
     void set(u32 address, T value) {
         constexpr ssi size = sizeof(T);
 
+        const MemoryPage &page = pages[address >> pageBits];
+        u32 offset = address & pageMask;
+
+        if (page.write && offset <= pageSize - size) {
+            value = swap(value);
+            std::memcpy(page.write + offset, &value, size);
+            return;
+        }
+
+        if (u8 *data = resolveData(address, size, MemoryRegion::Intention::Write)) {
+            value = swap(value);
+            std::memcpy(data, &value, size);
+            return;
+        }
+
+        if (writeDevice(address, size, static_cast<u64>(value)))
+            return;
+
         for (ssi a = 0; a < size; a++) {
             setByte(address + a, (value >> ((size - a - 1) * 8)) & 0xFF);
         }
@@ -95,4 +328,14 @@ public:
     const Rom &rom;
 
     explicit Memory(const Rom &rom);
+};
+
+static_assert(sizeof(PageData) == Memory::pageSize, "PageData has to match the page table");
+
+// RDRAM and SP memory by page, then the register blocks, PIF RAM and DMA state field by field, little endian.
+// Pages are shared between states.
+class MemoryState {
+public:
+    std::vector<std::shared_ptr<const PageData>> pages;
+    std::vector<u8> registers;
 };
\ No newline at end of file
@@ -2,14 +2,26 @@
 
 #include <util/util.h>
 
+// Register blocks as the guest sees them, one u32 per register in address order.
+
 class MipsInterface {
+public:
+    // interrupt and interruptMask bits
+    static constexpr u32 sp = 1 << 0;
+    static constexpr u32 si = 1 << 1;
+    static constexpr u32 ai = 1 << 2;
+    static constexpr u32 vi = 1 << 3;
+    static constexpr u32 pi = 1 << 4;
+    static constexpr u32 dp = 1 << 5;
+
     u32 mode = 0;
-    u32 version = 0;
+    u32 version = 0x02020102;
     u32 interrupt = 0;
     u32 interruptMask = 0;
 };
 
 class RamRegisters {
+public:
     u32 config = 0;
     u32 id = 0;
     u32 delay = 0;
@@ -23,6 +35,7 @@ class RamRegisters {
 };
 
 class RamInterface {
+public:
     u32 mode = 0;
     u32 config = 0;
     u32 currentLoad = 0;
@@ -34,29 +47,55 @@ class RamInterface {
 };
 
 class SignalRegisters {
+public:
+    // statusRegister bits
+    static constexpr u32 halt = 1 << 0;
+    static constexpr u32 broke = 1 << 1;
+    static constexpr u32 busy = 1 << 2;
+    static constexpr u32 full = 1 << 3;
+    static constexpr u32 singleStep = 1 << 5;
+    static constexpr u32 interruptOnBreak = 1 << 6;
+    static constexpr u32 signals = 7; // first of eight signal bits
+
     u32 memAddress = 0;
     u32 dramAddress = 0;
     u32 readLength = 0;
     u32 writeLength = 0;
-    u32 statusRegister = 0;
+    u32 statusRegister = halt; // the RSP starts halted
     u32 dmaFull = 0;
     u32 dmaBusy = 0;
     u32 semaphore = 0;
 };
 
+// An SP DMA request as the registers held it when it was made, the data moves once it starts.
+class SignalDma {
+public:
+    u32 memAddress = 0;
+    u32 dramAddress = 0;
+    u32 length = 0;
+    u32 toRam = 0;
+};
+
 class ParallelDom {
-    u32 latency;
-    u32 pulseWidth;
-    u32 pageSize;
-    u32 release;
+public:
+    u32 latency = 0;
+    u32 pulseWidth = 0;
+    u32 pageSize = 0;
+    u32 release = 0;
 };
 
 class ParallelInterface {
-    u32 dramAddress;
-    u32 cartAddress;
-    u32 readLength;
-    u32 writeLength;
-    u32 status;
+public:
+    // status bits as read
+    static constexpr u32 busy = 1 << 0;
+    static constexpr u32 ioBusy = 1 << 1;
+    static constexpr u32 error = 1 << 2;
+
+    u32 dramAddress = 0;
+    u32 cartAddress = 0;
+    u32 readLength = 0;
+    u32 writeLength = 0;
+    u32 status = 0;
     ParallelDom dom1;
     ParallelDom dom2;
 };
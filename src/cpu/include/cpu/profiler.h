@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cpu/cache.h>
+
+#include <ctime>
+#include <map>
+#include <unordered_map>
+
+class ProfileSettings {
+public:
+    bool enabled = false;
+
+    // report destination, empty prints to stdout
+    std::string output;
+
+    // host timer samples per second of the cpu thread's time
+    u32 frequency = 1000;
+};
+
+// Counters for every version of the block starting at one physical address.
+class BlockProfile {
+public:
+    u32 address = 0; // virtual address it was last compiled at
+    u32 length = 0;
+
+    u64 executions = 0;
+
+    // written by the SIGPROF handler only
+    volatile u64 samples = 0;
+
+    // opcodes of the current version, executions since it was compiled are folded in when it is replaced
+    std::vector<u16> opcodes;
+    u64 pending = 0;
+};
+
+// Counts executions per block and per opcode, and samples the running block from a host profiling timer.
+// Blocks are counted once per run and charged their whole length, step counts single instructions.
+// The timer follows the thread that constructs the profiler, which has to be the one running the cpu.
+class Profiler {
+    ProfileSettings settings;
+
+    timer_t timer = {};
+    bool armed = false;
+
+    std::unordered_map<u32, BlockProfile> blocks;
+    std::vector<u64> opcodes;
+    std::map<std::string, u64> unimplemented;
+
+    // host samples taken outside of any block
+    volatile u64 outside = 0;
+
+    static void sample(int);
+    void fold(BlockProfile &profile);
+
+public:
+    // block being run, read by the timer signal
+    BlockProfile *volatile current = nullptr;
+
+    // called when a block is compiled, the returned profile stays valid for the profiler's lifetime
+    BlockProfile *attach(u32 physical, u32 address, const std::vector<Instruction> &instructions);
+
+    void enter(BlockProfile *profile) {
+        current = profile;
+        profile->executions++;
+        profile->pending++;
+    }
+
+    void step(const Instruction &instruction) {
+        current = nullptr;
+        opcodes[instruction.opcode]++;
+    }
+
+    void miss(const std::string &name) { unimplemented[name]++; }
+
+    // symbolizes against the ROM's boot address, rom is the cartridge size in bytes
+    void write(u32 boot, ssi rom);
+
+    explicit Profiler(ProfileSettings settings);
+    ~Profiler();
+
+    Profiler(const Profiler &) = delete;
+    Profiler &operator=(const Profiler &) = delete;
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cpu/block.h>
+#include <cpu/emitter.h>
+
+class Registers;
+class DelaySlot;
+
+// Executable memory for translated blocks, filled front to back and reset as a whole.
+class CodeBuffer {
+    u8 *memory = nullptr;
+    ssi size = 0;
+    ssi used = 0;
+    bool exhausted = false;
+
+public:
+    bool valid() const { return memory != nullptr; }
+    bool full() const { return exhausted; }
+
+    // copies code in and returns where it landed, nullptr once the buffer is full
+    const void *write(const std::vector<u8> &code);
+    void reset();
+
+    explicit CodeBuffer(ssi size);
+    ~CodeBuffer();
+
+    CodeBuffer(const CodeBuffer &) = delete;
+    CodeBuffer &operator=(const CodeBuffer &) = delete;
+};
+
+// Translates blocks to x86-64. Guest registers used most in a block live in callee saved host registers,
+// loads and stores go straight through the page table, instructions without a translation call their handler.
+// Blocks keep the cpu's cycle count current themselves, before every handler they call and at every exit.
+class Recompiler {
+    Cpu &cpu;
+    Registers &registers;
+    DelaySlot &slot;
+    Memory &memory;
+    u64 &cycles;
+
+    CodeBuffer buffer;
+
+    bool emit(Emitter &emitter, const Block &block);
+
+public:
+    static bool supported();
+
+    // nullptr when the block can't be translated or the buffer is full
+    Block::Code compile(const Block &block);
+
+    // once full the caller resets the buffer and drops every block's code
+    bool full() const { return buffer.full(); }
+    void reset();
+
+    Recompiler(Cpu &cpu, Registers &registers, DelaySlot &slot, Memory &memory, u64 &cycles);
+};
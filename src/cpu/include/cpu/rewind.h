@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cpu/snapshot.h>
+
+#include <deque>
+
+// One page that changed between a rewind point and the next, as the packed XOR of both versions.
+class PageDelta {
+public:
+    u32 index = 0; // into MemoryState::pages
+    std::vector<u8> packed;
+};
+
+// Everything a point needs besides memory is small enough to keep whole.
+class RewindPoint {
+public:
+    Registers registers;
+    DelaySlot slot;
+    Cop0 cop0;
+    u64 cycles = 0;
+    IdleStats idle;
+    RspState rsp;
+
+    std::vector<u8> registerBlocks;
+    std::vector<PageDelta> deltas;
+
+    ssi bytes() const;
+};
+
+// Recent machine states. The newest is kept as a Snapshot sharing its pages with the live Memory,
+// every older one only as the changes that turn the point after it back into it.
+class RewindBuffer {
+    RewindSettings settings;
+
+    Snapshot latest;
+    bool filled = false;
+
+    std::deque<RewindPoint> history;
+    ssi used = 0;
+
+    PageData scratch;
+
+public:
+    u64 interval() const { return settings.interval; }
+
+    ssi size() const { return history.size() + filled; }
+    bool empty() const { return !filled; }
+
+    // bytes held by older points, the newest point only costs the pages written since it was taken
+    ssi bytes() const { return used; }
+
+    const Snapshot &newest() const { return latest; }
+
+    // Makes snapshot the newest point, dropping the oldest ones until the history fits the capacity.
+    void push(Snapshot snapshot);
+    // Forgets the newest point, the one before it becomes the newest.
+    void drop();
+
+    explicit RewindBuffer(const RewindSettings &settings);
+};
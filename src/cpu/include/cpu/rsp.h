@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cpu/settings.h>
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Single producer, single consumer ring, neither side ever locks.
+template <typename T, u32 capacity>
+class Mailbox {
+    static_assert((capacity & (capacity - 1)) == 0, "capacity has to be a power of two");
+
+    T items[capacity];
+
+    alignas(64) std::atomic<u32> head{0}; // written by the producer
+    alignas(64) std::atomic<u32> tail{0}; // written by the consumer
+
+public:
+    bool push(const T &item) {
+        u32 position = head.load(std::memory_order_relaxed);
+
+        if (position - tail.load(std::memory_order_acquire) == capacity)
+            return false;
+
+        items[position & (capacity - 1)] = item;
+        head.store(position + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    bool pop(T &item) {
+        u32 position = tail.load(std::memory_order_relaxed);
+
+        if (position == head.load(std::memory_order_acquire))
+            return false;
+
+        item = items[position & (capacity - 1)];
+        tail.store(position + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    bool empty() const {
+        return tail.load(std::memory_order_acquire) == head.load(std::memory_order_acquire);
+    }
+};
+
+enum class RspSignal : u8 {
+    Start, // the cpu cleared halt
+    Halt, // the cpu set halt
+    Reset, // the cpu restored a snapshot
+    Quit,
+    Break, // from the rsp, the task ended
+};
+
+// IMEM as a task found it, copied on the cpu thread so the rsp never reads SP memory the cpu is writing.
+typedef std::array<u8, kb(4)> RspCode;
+
+// Messages carry the epoch of the task they belong to, so anything from before a restart is dropped.
+class RspMessage {
+public:
+    RspSignal signal = RspSignal::Start;
+    bool running = false; // Reset only
+    u32 epoch = 0;
+    u64 time = 0;
+    std::shared_ptr<const RspCode> code; // Start and a running Reset
+};
+
+// What a snapshot keeps of the rsp, seen from the cpu side. A task that hasn't been seen to end resumes
+// from where it started.
+class RspState {
+public:
+    bool active = false;
+    u64 start = 0;
+};
+
+// The signal processor, kept in step with the cpu through mailboxes and the two clocks. Only the cpu
+// thread calls the public functions. Nothing decodes RSP microcode yet, a task ends the moment it
+// starts as if its first instruction were a break.
+class Rsp {
+    RspSettings settings;
+
+    Mailbox<RspMessage, 64> inbox;
+    Mailbox<RspMessage, 64> outbox;
+
+    // published by the cpu at each sync, the rsp doesn't run past it plus slack
+    alignas(64) std::atomic<u64> cpuClock{0};
+    // published by the rsp, the cpu doesn't run more than slack past it while a task is running
+    alignas(64) std::atomic<u64> rspClock{0};
+
+    // rsp side, only touched by whichever thread runs it
+    bool running = false;
+    bool quitting = false;
+    u64 clock = 0;
+    u32 taskEpoch = 0;
+    std::shared_ptr<const RspCode> code;
+
+    // cpu side
+    bool busy = false;
+    u32 epoch = 0;
+    u64 started = 0;
+
+    std::mutex parkMutex;
+    std::condition_variable parked;
+    std::thread thread;
+
+    void post(const RspMessage &message);
+    void receive();
+    void advance(u64 limit);
+    void loop();
+
+    bool collect();
+
+public:
+    // Called as status writes start or halt a task, imem is copied before start returns.
+    void start(u64 time, const u8 *imem);
+    void halt(u64 time);
+
+    // Hands the cpu's time over, lets an inline rsp catch up to it and waits for a threaded one that is
+    // more than slack behind. True if a task broke since the last sync.
+    bool sync(u64 time);
+
+    RspState state() const;
+    // Drops whatever was in flight after a snapshot restore and picks up the task state had, if any.
+    void reset(const RspState &state, u64 time, const u8 *imem);
+
+    // a task was started and the cpu hasn't seen it end
+    bool active() const { return busy; }
+    u64 interval() const { return settings.slack ? settings.slack : 1; }
+
+    explicit Rsp(const RspSettings &settings);
+    ~Rsp();
+};
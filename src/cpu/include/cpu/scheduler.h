@@ -0,0 +1,39 @@
+#pragma once
+
+#include <util/util.h>
+
+// Anything that happens at a point in guest time, at most one of each is pending.
+enum class EventType : u8 {
+    Compare, // cop0 Count reaches Compare
+    Stop, // a RunLimits bound might have been reached
+    Rewind, // time to record the next rewind point
+    Yield, // the end of a Cpu::slice
+    ParallelDma, // the PI finishes its transfer
+    SignalDma, // the SP finishes the transfer in flight
+    RspSync, // the cpu and a running RSP task compare notes
+    Interrupt, // an interrupt line or enable changed, taken at the next block boundary if it can be
+};
+
+class Event {
+public:
+    u64 time = 0;
+    EventType type = EventType::Compare;
+};
+
+// Pending events in a min-heap on time, the cpu only compares its cycle count against next() between blocks.
+class Scheduler {
+    std::vector<Event> events;
+
+public:
+    // time of the earliest pending event, never when nothing is scheduled
+    static constexpr u64 never = ~0ull;
+
+    u64 next() const { return events.empty() ? never : events.front().time; }
+
+    // replaces any pending event of the same type
+    void schedule(EventType type, u64 time);
+    void cancel(EventType type);
+
+    // removes the earliest event if it is due by now
+    bool pop(u64 now, EventType &type);
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cpu/trace.h>
+#include <cpu/idle.h>
+#include <cpu/profiler.h>
+
+enum class CpuEngine {
+    Interpreter,
+    Recompiler,
+};
+
+// Cpu::exec returns once either is reached, zero leaves it unbounded.
+class RunLimits {
+public:
+    u64 instructions = 0;
+    u64 cycles = 0;
+};
+
+// Snapshot files the emulator restores before running and writes once the cpu stops, empty for none.
+class SnapshotSettings {
+public:
+    std::string load;
+    std::string save;
+
+    bool compress = true;
+};
+
+// History the cpu keeps for Cpu::rewind, capacity zero keeps none.
+class RewindSettings {
+public:
+    ssi capacity = 0; // bytes
+    u64 interval = 1562500; // cycles between points, one NTSC frame
+
+    // points the emulator steps back once the cpu stops
+    u32 steps = 0;
+};
+
+// How the RSP keeps time with the cpu. Inline it runs on the cpu thread at every sync point, so runs are
+// reproducible. Threaded it runs on its own host thread, at most slack cycles either side of the cpu.
+class RspSettings {
+public:
+    bool threaded = false;
+    u64 slack = 15625; // cycles, also the time between sync points, a hundredth of a frame
+};
+
+class CpuSettings {
+public:
+    CpuEngine engine = CpuEngine::Interpreter;
+    TraceSettings trace;
+    IdleSettings idle;
+    RunLimits limits;
+    ProfileSettings profile;
+    SnapshotSettings snapshot;
+    RewindSettings rewind;
+    RspSettings rsp;
+};
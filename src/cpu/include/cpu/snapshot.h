@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cpu/cpu.h>
+#include <cpu/rsp.h>
+
+// Machine state from Cpu::snapshot. Memory pages are shared with the live Memory and other snapshots
+// until one side writes them, so copies and restores are cheap.
+class Snapshot {
+public:
+    Registers registers;
+    DelaySlot slot;
+    Cop0 cop0;
+    u64 cycles = 0;
+    IdleStats idle;
+    RspState rsp;
+
+    MemoryState memory;
+};
+
+// Layout: "SCOUTSAV", u32 version, u32 flags, cpu and rsp state, register blocks, then every page tagged as
+// zero, raw or run length encoded. Integers are little endian. Returns false if the file couldn't be written.
+bool saveSnapshot(const Snapshot &snapshot, const std::string &path, bool compress);
+bool loadSnapshot(const std::string &path, Snapshot &snapshot);
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <util/util.h>
+
+#include <fmt/format.h>
+
+#include <iterator>
+
+// Groups match the handler sections in cpu.h, used as bits in TraceSettings::classes.
+enum class TraceClass : u8 {
+    Alu,
+    Immediate,
+    Flow,
+    Data,
+    Cop0,
+};
+
+TraceClass classify(u32 instruction);
+bool parseTraceClass(const std::string &name, TraceClass &out);
+
+class TraceRange {
+public:
+    u32 start = 0;
+    u32 end = 0; // exclusive
+};
+
+class TraceSettings {
+public:
+    bool enabled = false;
+
+    // empty traces every address
+    std::vector<TraceRange> ranges;
+    u32 classes = ~0u;
+};
+
+// Buffered writer behind the DISASM macro, only instantiated when SCOUT_TRACE is defined.
+class Trace {
+    TraceSettings settings;
+    fmt::memory_buffer buffer;
+
+    static constexpr ssi flushSize = kb(64);
+
+public:
+    bool enabled(u64 pc, u32 instruction) const;
+
+    template <typename ...Args>
+    void write(const char *format, const Args &...args) {
+        fmt::vformat_to(std::back_inserter(buffer), format, fmt::make_format_args(args...));
+
+        if (buffer.size() >= flushSize)
+            flush();
+    }
+
+    void flush();
+
+    explicit Trace(TraceSettings settings);
+    ~Trace();
+};
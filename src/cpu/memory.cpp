@@ -1,17 +1,20 @@
 #include <cpu/memory.h>
 
+#include <util/log.h>
+
 #include <fmt/printf.h>
 
+#include <algorithm>
+#include <cstdlib>
+
 bool MemoryRegion::supports(Intention intention) const {
     switch (type) {
         case Type::Empty: return false;
         case Type::Dummy:
         case Type::Mirror:
         case Type::ReadWriteData:
-        case Type::ReadWriteDevice: return true;
-        case Type::ReadOnlyData:
-        case Type::ReadOnlyDevice: return intention == Intention::Read;
-        case Type::WriteOnlyDevice: return intention == Intention::Write;
+        case Type::Device: return true;
+        case Type::ReadOnlyData: return intention == Intention::Read;
         default: return false;
     }
 }
@@ -22,104 +25,964 @@ MemoryRegion::MemoryRegion(u32 start, u32 size, void *data)
     : start(start), size(size), type(Type::ReadWriteData), data(reinterpret_cast<u8 *>(data)) { }
 MemoryRegion::MemoryRegion(u32 start, u32 size, const void *data)
     : start(start), size(size), type(Type::ReadOnlyData), data(reinterpret_cast<u8 *>(const_cast<void *>(data))) { }
-MemoryRegion::MemoryRegion(u32 start, u32 size, MemoryRead device)
-    : start(start), size(size), type(Type::ReadOnlyDevice), readDevice(std::move(device)) { }
-MemoryRegion::MemoryRegion(u32 start, u32 size, MemoryWrite device)
-    : start(start), size(size), type(Type::WriteOnlyDevice), writeDevice(std::move(device)) { }
-MemoryRegion::MemoryRegion(u32 start, u32 size, MemoryRead read, MemoryWrite write)
-    : start(start), size(size), type(Type::ReadWriteDevice),
-    readDevice(std::move(read)), writeDevice(std::move(write)) { }
+MemoryRegion::MemoryRegion(u32 start, u32 size, Device device)
+    : start(start), size(size), type(Type::Device), device(device) { }
 MemoryRegion::MemoryRegion(u32 start, u32 size, u32 mirrorStart)
     : start(start), size(size), type(Type::Mirror), mirrorStart(mirrorStart) { }
 
 u8 unimplementedRead(u32 address) {
-    fmt::print("Unimplemented GET 0x{:0>8x}\n", address);
+    logUnimplemented(LogKind::Read, address);
 
     return 0;
 }
 
 void unimplementedWrite(u32 address, u8 value) {
-    fmt::print("Unimplemented SET 0x{:0>8x} = 0x{:0>2x}\n", address, value);
+    logUnimplemented(LogKind::Write, address, value);
 }
 
-MemoryRegion Memory::findRegion(u32 address, MemoryRegion::Intention intention) {
+const MemoryRegion *Memory::findRegion(u32 address, MemoryRegion::Intention intention) const {
     for (const MemoryRegion &region : regions) {
         if (address >= region.start && address < region.start + region.size && region.supports(intention)) {
-            return region;
+            return &region;
+        }
+    }
+
+    return nullptr;
+}
+
+const MemoryRegion *Memory::resolveRegion(u32 &address, MemoryRegion::Intention intention) const {
+    const MemoryRegion *region = findRegion(address, intention);
+
+    while (region && region->type == MemoryRegion::Type::Mirror) {
+        address += region->mirrorStart - region->start;
+        region = findRegion(address, intention);
+    }
+
+    return region;
+}
+
+u16 Memory::resolvePage(u32 &address, MemoryRegion::Intention intention) const {
+    while (true) {
+        u64 pageStart = address;
+        u64 pageEnd = pageStart + pageSize;
+
+        // the first region touching the page wins every byte only if it spans the whole page
+        for (ssi a = 0; a < regions.size(); a++) {
+            const MemoryRegion &region = regions[a];
+
+            u64 regionStart = region.start;
+            u64 regionEnd = regionStart + region.size;
+
+            if (!region.supports(intention) || regionEnd <= pageStart || regionStart >= pageEnd)
+                continue;
+
+            if (regionStart > pageStart || regionEnd < pageEnd)
+                return splitSlot;
+
+            if (region.type == MemoryRegion::Type::Mirror) {
+                address += region.mirrorStart - region.start;
+                break;
+            }
+
+            return static_cast<u16>(a + 1);
+        }
+
+        if (address == pageStart)
+            return noSlot;
+    }
+}
+
+void Memory::buildPages() {
+    assert(regions.size() < splitSlot);
+
+    auto fill = [this](u32 index) {
+        MemoryPage &page = pages[index];
+
+        u32 readAddress = index << pageBits;
+        u32 writeAddress = index << pageBits;
+        u16 readSlot = resolvePage(readAddress, MemoryRegion::Intention::Read);
+        u16 writeSlot = resolvePage(writeAddress, MemoryRegion::Intention::Write);
+
+        // pages left zeroed are unmapped, only touch the ones that resolve to something
+        if (readSlot == noSlot && writeSlot == noSlot)
+            return;
+
+        // a page only mirrors once, so read and write resolve to the same place whenever both are mapped
+        page.address = readSlot != noSlot ? readAddress : writeAddress;
+        page.readSlot = readSlot;
+        page.writeSlot = writeSlot;
+
+        auto direct = [this](u16 slot, u32 address, MemoryRegion::Type type) -> u8 * {
+            if (slot == noSlot || slot == splitSlot)
+                return nullptr;
+
+            const MemoryRegion &region = regions[slot - 1];
+
+            if (region.type != MemoryRegion::Type::ReadWriteData && region.type != type)
+                return nullptr;
+
+            return region.data + (address - region.start);
+        };
+
+        page.read = direct(readSlot, readAddress, MemoryRegion::Type::ReadOnlyData);
+        page.write = direct(writeSlot, writeAddress, MemoryRegion::Type::ReadWriteData);
+    };
+
+    for (const MemoryRegion &region : regions) {
+        u64 first = region.start >> pageBits;
+        u64 last = (static_cast<u64>(region.start) + region.size + pageMask) >> pageBits;
+
+        for (u64 index = first; index < last; index++)
+            fill(static_cast<u32>(index));
+    }
+}
+
+const MemoryRegion *Memory::pageRegion(u16 slot, u32 &address, MemoryRegion::Intention intention) const {
+    switch (slot) {
+        case noSlot: return nullptr;
+        case splitSlot: return resolveRegion(address, intention);
+        default: return &regions[slot - 1];
+    }
+}
+
+void Memory::setWritable(u32 page, bool writable) {
+    u32 address = page << pageBits;
+
+    auto apply = [this, address, writable](u32 virtualAddress) {
+        MemoryPage &entry = pages[virtualAddress >> pageBits];
+
+        if (entry.address != address || !entry.read || entry.writeSlot == noSlot || entry.writeSlot == splitSlot)
+            return;
+
+        // only read-write data is ever watched, its read and write pointers are the same
+        if (regions[entry.writeSlot - 1].type == MemoryRegion::Type::ReadWriteData)
+            entry.write = writable ? entry.read : nullptr;
+    };
+
+    apply(address);
+
+    for (const MemoryRegion &region : regions) {
+        if (region.type == MemoryRegion::Type::Mirror
+            && address >= region.mirrorStart && address - region.mirrorStart < region.size) {
+            apply(address - region.mirrorStart + region.start);
         }
     }
+}
+
+void Memory::watch(u32 page) {
+    assert(page < watched.size());
+
+    if (watched[page])
+        return;
+
+    watched[page] = true;
+    setWritable(page, false);
+}
+
+void Memory::protect(u32 page) {
+    if (clean[page])
+        return;
+
+    clean[page] = true;
+    setWritable(page, false);
+}
 
-    return { };
+void Memory::release(u32 address) {
+    u32 page = address >> pageBits;
+
+    if (page >= watched.size() || (!watched[page] && !clean[page]))
+        return;
+
+    bool code = watched[page];
+
+    watched[page] = false;
+    clean[page] = false;
+    setWritable(page, true);
+
+    if (code && watcher)
+        watcher(page);
+}
+
+u32 Memory::statePages() {
+    return (ramSize + spMemorySize) / pageSize;
 }
 
-u8 Memory::getByte(u32 address) {
-    MemoryRegion region = findRegion(address, MemoryRegion::Intention::Read);
-    u32 subAddress = address;
+u32 Memory::statePhysical(u32 index) const {
+    u32 ramPages = ram.size() / pageSize;
+
+    return index < ramPages ? index : (0x04000000 >> pageBits) + index - ramPages;
+}
 
-    while (region.type == MemoryRegion::Type::Mirror) {
-        subAddress += region.mirrorStart - region.start;
-        region = findRegion(subAddress, MemoryRegion::Intention::Read);
+u8 *Memory::stateData(u32 index) {
+    u32 ramPages = ram.size() / pageSize;
+
+    return index < ramPages ? ram.data() + index * pageSize : spMemory.data() + (index - ramPages) * pageSize;
+}
+
+// Register state goes field by field, little endian, so it means the same on any host and doesn't
+// depend on how the compiler lays the blocks out.
+class StateWriter {
+    std::vector<u8> &out;
+
+public:
+    template <typename T>
+    void operator()(T value) {
+        for (ssi a = 0; a < sizeof(T); a++)
+            out.push_back(static_cast<u8>(static_cast<u64>(value) >> (a * 8)));
     }
 
-    assert(region.type != MemoryRegion::Type::Empty);
+    explicit StateWriter(std::vector<u8> &out) : out(out) { }
+};
+
+class StateReader {
+    const u8 *in;
+
+public:
+    template <typename T>
+    void operator()(T &value) {
+        u64 result = 0;
+        for (ssi a = 0; a < sizeof(T); a++)
+            result |= static_cast<u64>(*in++) << (a * 8);
+
+        value = static_cast<T>(result);
+    }
+
+    explicit StateReader(const u8 *in) : in(in) { }
+};
+
+class StateCounter {
+public:
+    ssi bytes = 0;
+
+    template <typename T>
+    void operator()(T &) { bytes += sizeof(T); }
+};
 
-    switch (region.type) {
+template <typename Visit>
+static void visitBlock(MipsInterface &mi, Visit &visit) {
+    visit(mi.mode);
+    visit(mi.version);
+    visit(mi.interrupt);
+    visit(mi.interruptMask);
+}
+
+template <typename Visit>
+static void visitBlock(RamRegisters &rr, Visit &visit) {
+    visit(rr.config);
+    visit(rr.id);
+    visit(rr.delay);
+    visit(rr.mode);
+    visit(rr.internal);
+    visit(rr.row);
+    visit(rr.rasInterval);
+    visit(rr.minInterval);
+    visit(rr.addrSelect);
+    visit(rr.manufacturer);
+}
+
+template <typename Visit>
+static void visitBlock(RamInterface &ri, Visit &visit) {
+    visit(ri.mode);
+    visit(ri.config);
+    visit(ri.currentLoad);
+    visit(ri.select);
+    visit(ri.refresh);
+    visit(ri.latency);
+    visit(ri.readError);
+    visit(ri.writeError);
+}
+
+template <typename Visit>
+static void visitBlock(SignalRegisters &sp, Visit &visit) {
+    visit(sp.memAddress);
+    visit(sp.dramAddress);
+    visit(sp.readLength);
+    visit(sp.writeLength);
+    visit(sp.statusRegister);
+    visit(sp.dmaFull);
+    visit(sp.dmaBusy);
+    visit(sp.semaphore);
+}
+
+template <typename Visit>
+static void visitBlock(SignalDma &dma, Visit &visit) {
+    visit(dma.memAddress);
+    visit(dma.dramAddress);
+    visit(dma.length);
+    visit(dma.toRam);
+}
+
+template <typename Visit>
+static void visitBlock(ParallelDom &dom, Visit &visit) {
+    visit(dom.latency);
+    visit(dom.pulseWidth);
+    visit(dom.pageSize);
+    visit(dom.release);
+}
+
+template <typename Visit>
+static void visitBlock(ParallelInterface &pi, Visit &visit) {
+    visit(pi.dramAddress);
+    visit(pi.cartAddress);
+    visit(pi.readLength);
+    visit(pi.writeLength);
+    visit(pi.status);
+    visitBlock(pi.dom1, visit);
+    visitBlock(pi.dom2, visit);
+}
+
+template <typename T, ssi size, typename Visit>
+static void visitBlock(std::array<T, size> &values, Visit &visit) {
+    for (T &value : values)
+        visit(value);
+}
+
+template <typename Visit>
+void Memory::visitRegisters(MipsInterface &mips, RamRegisters &ramRegisters, RamInterface &ramInterface,
+    SignalRegisters &sp, ParallelInterface &pi, std::array<u8, 64> &pif,
+    std::array<u64, static_cast<ssi>(Device::Count)> &ends, SignalDma &queued, Visit &visit) {
+    visitBlock(mips, visit);
+    visitBlock(ramRegisters, visit);
+    visitBlock(ramInterface, visit);
+    visitBlock(sp, visit);
+    visitBlock(pi, visit);
+    visitBlock(pif, visit);
+    visitBlock(ends, visit);
+    visitBlock(queued, visit);
+}
+
+template <typename Visit>
+void Memory::visitRegisters(Visit &visit) {
+    visitRegisters(mipsInterface, ramRegisters, ramInterface, signalRegisters, parallelInterface, pifRam,
+        transferEnds, signalQueued, visit);
+}
+
+MemoryState Memory::capture() {
+    base.resize(statePages());
+
+    for (u32 a = 0; a < base.size(); a++) {
+        u32 page = statePhysical(a);
+
+        if (clean[page] && base[a])
+            continue;
+
+        auto copy = std::make_shared<PageData>();
+        std::memcpy(copy->data(), stateData(a), pageSize);
+
+        base[a] = std::move(copy);
+        protect(page);
+    }
+
+    MemoryState state;
+    state.pages = base;
+
+    StateWriter writer(state.registers);
+    visitRegisters(writer);
+
+    return state;
+}
+
+void Memory::restore(const MemoryState &state) {
+    assert(state.pages.size() == statePages());
+
+    base.resize(statePages());
+
+    for (u32 a = 0; a < base.size(); a++) {
+        u32 page = statePhysical(a);
+
+        if (clean[page] && base[a] == state.pages[a])
+            continue;
+
+        // lets the block cache forget anything it decoded from the old contents
+        release(page << pageBits);
+
+        std::memcpy(stateData(a), state.pages[a]->data(), pageSize);
+
+        base[a] = state.pages[a];
+        protect(page);
+    }
+
+    assert(state.registers.size() == registerBytes());
+
+    StateReader reader(state.registers.data());
+    visitRegisters(reader);
+}
+
+ssi Memory::registerBytes() {
+    // every field has a fixed width, so the defaults count the same as any other state
+    MipsInterface mips;
+    RamRegisters ramRegisters;
+    RamInterface ramInterface;
+    SignalRegisters sp;
+    ParallelInterface pi;
+    std::array<u8, sizeof(pifRam)> pif = {};
+    std::array<u64, static_cast<ssi>(Device::Count)> ends = {};
+    SignalDma queued;
+
+    StateCounter counter;
+    visitRegisters(mips, ramRegisters, ramInterface, sp, pi, pif, ends, queued, counter);
+
+    return counter.bytes;
+}
+
+bool Memory::passive(u32 address) const {
+    const MemoryPage &page = pages[address >> pageBits];
+
+    if (page.read)
+        return true;
+
+    u32 subAddress = page.address | (address & pageMask);
+    const MemoryRegion *region = pageRegion(page.readSlot, subAddress, MemoryRegion::Intention::Read);
+
+    if (!region)
+        return false;
+
+    switch (region->type) {
         case MemoryRegion::Type::ReadOnlyData:
         case MemoryRegion::Type::ReadWriteData:
-            return region.data[subAddress - region.start];
-        case MemoryRegion::Type::ReadOnlyDevice:
-        case MemoryRegion::Type::ReadWriteDevice:
-            return region.readDevice(subAddress);
-        case MemoryRegion::Type::Dummy:
-            return unimplementedRead(address);
+            return true;
+        case MemoryRegion::Type::Device:
+            // device registers only change on guest writes and scheduled events, except that reading
+            // the SP semaphore takes it
+            return region->device != Device::Signal || (subAddress - region->start) >> 2 != 7;
         default:
-            assert(false);
+            return false;
     }
+}
 
-    return 0;
+u8 *Memory::resolveData(u32 address, ssi size, MemoryRegion::Intention intention) {
+    const MemoryPage &page = pages[address >> pageBits];
+    u32 subAddress = page.address | (address & pageMask);
+
+    bool read = intention == MemoryRegion::Intention::Read;
+    const MemoryRegion *region = pageRegion(read ? page.readSlot : page.writeSlot, subAddress, intention);
+
+    if (!region || subAddress - region->start + size > region->size)
+        return nullptr;
+
+    // a misaligned write can run into the next page, which needs releasing too
+    if (!read) {
+        for (u32 index = subAddress >> pageBits; index <= (subAddress + size - 1) >> pageBits; index++)
+            release(index << pageBits);
+    }
+
+    switch (region->type) {
+        case MemoryRegion::Type::ReadOnlyData:
+        case MemoryRegion::Type::ReadWriteData:
+            return region->data + (subAddress - region->start);
+        default:
+            return nullptr;
+    }
+}
+
+const Memory::DeviceHandlers Memory::devices[static_cast<ssi>(Device::Count)] = {
+    {&Memory::readRamRegisters, &Memory::writeRamRegisters},
+    {&Memory::readSignal, &Memory::writeSignal},
+    {&Memory::readMips, &Memory::writeMips},
+    {&Memory::readRamInterface, &Memory::writeRamInterface},
+    {&Memory::readParallel, &Memory::writeParallel},
+};
+
+// big endian position of size bytes at offset within a word
+static u32 laneShift(u32 offset, ssi size) {
+    return (4 - size - (offset & 3)) * 8;
+}
+
+static u32 laneMask(ssi size) {
+    return size == 4 ? 0xFFFFFFFF : (1u << (size * 8)) - 1;
+}
+
+bool Memory::readDevice(u32 address, ssi size, u64 &value) {
+    const MemoryPage &page = pages[address >> pageBits];
+    u32 subAddress = page.address | (address & pageMask);
+
+    const MemoryRegion *region = pageRegion(page.readSlot, subAddress, MemoryRegion::Intention::Read);
+
+    if (!region || region->type != MemoryRegion::Type::Device)
+        return false;
+
+    u32 offset = subAddress - region->start;
+
+    if (offset + size > region->size || (size == 8 ? offset & 3 : (offset & 3) + size > 4))
+        return false;
+
+    auto read = devices[static_cast<ssi>(region->device)].read;
+    u32 index = offset >> 2;
+
+    if (size == 8)
+        value = static_cast<u64>((this->*read)(index)) << 32 | (this->*read)(index + 1);
+    else
+        value = ((this->*read)(index) >> laneShift(offset, size)) & laneMask(size);
+
+    return true;
 }
 
-void Memory::setByte(u32 address, u8 value) {
-    MemoryRegion region = findRegion(address, MemoryRegion::Intention::Write);
-    u32 subAddress = address;
+bool Memory::writeDevice(u32 address, ssi size, u64 value) {
+    const MemoryPage &page = pages[address >> pageBits];
+    u32 subAddress = page.address | (address & pageMask);
 
-    while (region.type == MemoryRegion::Type::Mirror) {
-        subAddress += region.mirrorStart - region.start;
-        region = findRegion(subAddress, MemoryRegion::Intention::Write);
+    const MemoryRegion *region = pageRegion(page.writeSlot, subAddress, MemoryRegion::Intention::Write);
+
+    if (!region || region->type != MemoryRegion::Type::Device)
+        return false;
+
+    u32 offset = subAddress - region->start;
+
+    if (offset + size > region->size || (size == 8 ? offset & 3 : (offset & 3) + size > 4))
+        return false;
+
+    auto write = devices[static_cast<ssi>(region->device)].write;
+    u32 index = offset >> 2;
+    bool before = interrupted();
+
+    if (size == 8) {
+        (this->*write)(index, static_cast<u32>(value >> 32), 0xFFFFFFFF);
+        (this->*write)(index + 1, static_cast<u32>(value), 0xFFFFFFFF);
+    } else {
+        u32 shift = laneShift(offset, size);
+        u32 mask = laneMask(size) << shift;
+
+        (this->*write)(index, (static_cast<u32>(value) << shift) & mask, mask);
+    }
+
+    if (!before)
+        notifyInterrupt();
+
+    return true;
+}
+
+// keeps the bits outside mask, used by registers that just store what they're given
+static void store(u32 &target, u32 value, u32 mask) {
+    target = (target & ~mask) | (value & mask);
+}
+
+// set and clear bit pairs in a written word, the pair for a flag starting at bit
+static void setClear(u32 &target, u32 written, u32 bit, u32 flag) {
+    if (written & (1u << bit))
+        target &= ~flag;
+    if (written & (1u << (bit + 1)))
+        target |= flag;
+}
+
+// readDevice and writeDevice keep index inside the region, which is sized after the block
+template <typename Block>
+static u32 &registerAt(Block &block, u32 index) {
+    static_assert(sizeof(Block) % sizeof(u32) == 0, "register blocks are whole words");
+    assert(index < sizeof(Block) / sizeof(u32));
+
+    return reinterpret_cast<u32 *>(&block)[index];
+}
+
+u32 Memory::readRamRegisters(u32 index) {
+    return registerAt(ramRegisters, index);
+}
+
+void Memory::writeRamRegisters(u32 index, u32 value, u32 mask) {
+    store(registerAt(ramRegisters, index), value, mask);
+}
+
+u32 Memory::readRamInterface(u32 index) {
+    return registerAt(ramInterface, index);
+}
+
+void Memory::writeRamInterface(u32 index, u32 value, u32 mask) {
+    store(registerAt(ramInterface, index), value, mask);
+}
+
+u32 Memory::readSignal(u32 index) {
+    SignalRegisters &sp = signalRegisters;
+
+    switch (index) {
+        case 5: return (sp.statusRegister & SignalRegisters::full) ? 1 : 0;
+        case 6: return (sp.statusRegister & SignalRegisters::busy) ? 1 : 0;
+        case 7: {
+            // reading takes the semaphore, the value before tells the guest whether it already was
+            u32 value = sp.semaphore;
+            sp.semaphore = 1;
+            return value;
+        }
+        default: return registerAt(sp, index);
+    }
+}
+
+void Memory::writeSignal(u32 index, u32 value, u32 mask) {
+    SignalRegisters &sp = signalRegisters;
+
+    switch (index) {
+        case 4: {
+            u32 written = value & mask;
+            u32 before = sp.statusRegister;
+
+            setClear(sp.statusRegister, written, 0, SignalRegisters::halt);
+            if (written & (1u << 2))
+                sp.statusRegister &= ~SignalRegisters::broke;
+            if (written & (1u << 3))
+                mipsInterface.interrupt &= ~MipsInterface::sp;
+            if (written & (1u << 4))
+                mipsInterface.interrupt |= MipsInterface::sp;
+            setClear(sp.statusRegister, written, 5, SignalRegisters::singleStep);
+            setClear(sp.statusRegister, written, 7, SignalRegisters::interruptOnBreak);
+
+            for (u32 a = 0; a < 8; a++)
+                setClear(sp.statusRegister, written, 9 + a * 2, 1u << (SignalRegisters::signals + a));
+
+            if (((before ^ sp.statusRegister) & SignalRegisters::halt) && haltChanged)
+                haltChanged(rspHalted());
+
+            break;
+        }
+        case 2:
+        case 3:
+            store(registerAt(sp, index), value, mask);
+            startSignal(index == 3);
+            break;
+        case 5:
+        case 6: break;
+        case 7: sp.semaphore = 0; break;
+        default: store(registerAt(sp, index), value, mask);
+    }
+}
+
+u32 Memory::readMips(u32 index) {
+    return registerAt(mipsInterface, index);
+}
+
+void Memory::writeMips(u32 index, u32 value, u32 mask) {
+    MipsInterface &mi = mipsInterface;
+    u32 written = value & mask;
+
+    switch (index) {
+        case 0:
+            // init length in the low seven bits, then init mode, ebus test and RDRAM register mode
+            store(mi.mode, written, mask & 0x7F);
+            setClear(mi.mode, written, 7, 1u << 7);
+            setClear(mi.mode, written, 9, 1u << 8);
+            if (written & (1u << 11))
+                mi.interrupt &= ~MipsInterface::dp;
+            setClear(mi.mode, written, 12, 1u << 9);
+            break;
+        case 3: {
+            const u32 order[] = {
+                MipsInterface::sp, MipsInterface::si, MipsInterface::ai,
+                MipsInterface::vi, MipsInterface::pi, MipsInterface::dp,
+            };
+
+            for (u32 a = 0; a < 6; a++)
+                setClear(mi.interruptMask, written, a * 2, order[a]);
+
+            break;
+        }
+        default:
+            // version and interrupt are read only
+            break;
+    }
+}
+
+u32 Memory::readParallel(u32 index) {
+    return registerAt(parallelInterface, index);
+}
+
+void Memory::writeParallel(u32 index, u32 value, u32 mask) {
+    ParallelInterface &pi = parallelInterface;
+
+    switch (index) {
+        case 2:
+        case 3:
+            store(registerAt(pi, index), value, mask);
+            startParallel(index == 2);
+            break;
+        case 4: {
+            u32 written = value & mask;
+
+            // a reset abandons the DMA in flight, it completes without an interrupt
+            if (written & (1u << 0))
+                pi.status = 0;
+            if (written & (1u << 1))
+                mipsInterface.interrupt &= ~MipsInterface::pi;
+
+            break;
+        }
+        default: store(registerAt(pi, index), value, mask);
+    }
+}
+
+void Memory::breakSignal() {
+    SignalRegisters &sp = signalRegisters;
+    sp.statusRegister |= SignalRegisters::halt | SignalRegisters::broke;
+
+    if (sp.statusRegister & SignalRegisters::interruptOnBreak) {
+        bool before = interrupted();
+        mipsInterface.interrupt |= MipsInterface::sp;
+
+        if (!before)
+            notifyInterrupt();
+    }
+}
+
+void Memory::notifyInterrupt() {
+    if (interrupted() && interruptRaised)
+        interruptRaised();
+}
+
+void Memory::beginTransfer(Device device, u64 duration) {
+    if (transfer)
+        transferEnds[static_cast<ssi>(device)] = transfer(device, duration);
+    else
+        completeTransfer(device);
+}
+
+void Memory::completeTransfer(Device device) {
+    transferEnds[static_cast<ssi>(device)] = 0;
+
+    switch (device) {
+        case Device::Parallel:
+            if (parallelInterface.status & ParallelInterface::busy) {
+                bool before = interrupted();
+
+                parallelInterface.status &= ~ParallelInterface::busy;
+                mipsInterface.interrupt |= MipsInterface::pi;
+
+                if (!before)
+                    notifyInterrupt();
+            }
+            break;
+        case Device::Signal: {
+            SignalRegisters &sp = signalRegisters;
+            sp.statusRegister &= ~SignalRegisters::busy;
+
+            // the queued transfer moves up and only now copies its data
+            if (sp.statusRegister & SignalRegisters::full) {
+                sp.statusRegister = (sp.statusRegister & ~SignalRegisters::full) | SignalRegisters::busy;
+
+                SignalDma request = signalQueued;
+                signalQueued = SignalDma();
+                runSignal(request);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void Memory::copySignalRow(u32 dram, u32 mem, u32 size, bool toRam) {
+    // mem picks DMEM or IMEM with bit 12 and wraps within that half
+    u32 bank = mem & 0x1000;
+    u32 offset = mem & 0xFFF;
+
+    while (size) {
+        u32 chunk = std::min(size, 0x1000 - offset);
+        u8 *sp = spMemory.data() + bank + offset;
+
+        // past the end of RDRAM reads as zero and drops writes
+        u32 inside = dram < ram.size() ? static_cast<u32>(std::min<u64>(chunk, ram.size() - dram)) : 0;
+
+        if (toRam) {
+            if (inside) {
+                for (u32 page = dram >> pageBits; page <= (dram + inside - 1) >> pageBits; page++)
+                    release(page << pageBits);
+
+                std::memcpy(ram.data() + dram, sp, inside);
+            }
+        } else {
+            u32 physical = 0x04000000 + bank + offset;
+
+            for (u32 page = physical >> pageBits; page <= (physical + chunk - 1) >> pageBits; page++)
+                release(page << pageBits);
+
+            std::memcpy(sp, ram.data() + dram, inside);
+            std::memset(sp + inside, 0, chunk - inside);
+        }
+
+        dram += chunk;
+        offset = 0;
+        size -= chunk;
+    }
+}
+
+void Memory::startSignal(bool toRam) {
+    SignalRegisters &sp = signalRegisters;
+
+    // a third request while one is in flight and one queued stalls on hardware, here it's dropped
+    if (sp.statusRegister & SignalRegisters::full)
+        return;
+
+    SignalDma request;
+    request.memAddress = sp.memAddress;
+    request.dramAddress = sp.dramAddress;
+    request.length = toRam ? sp.writeLength : sp.readLength;
+    request.toRam = toRam;
+
+    if (sp.statusRegister & SignalRegisters::busy) {
+        sp.statusRegister |= SignalRegisters::full;
+        signalQueued = request;
+    } else {
+        sp.statusRegister |= SignalRegisters::busy;
+        runSignal(request);
     }
+}
+
+void Memory::runSignal(const SignalDma &request) {
+    SignalRegisters &sp = signalRegisters;
+    u32 length = request.length;
+    bool toRam = request.toRam != 0;
+
+    // rows of length bytes rounded up to 8, RDRAM skips ahead between rows while SP memory doesn't
+    u32 size = (length & 0xFF8) + 8;
+    u32 rows = ((length >> 12) & 0xFF) + 1;
+    u32 skip = (length >> 20) & 0xFF8;
+
+    u32 mem = request.memAddress & 0x1FF8;
+    u32 dram = request.dramAddress & 0x00FFFFF8;
+
+    for (u32 row = 0; row < rows; row++) {
+        copySignalRow(dram, mem, size, toRam);
+
+        mem = (mem & 0x1000) | ((mem + size) & 0xFFF);
+        dram = (dram + size + skip) & 0x00FFFFF8;
+    }
+
+    // the registers are left pointing past the transfer with the length counted down
+    sp.memAddress = mem;
+    sp.dramAddress = dram;
+    (toRam ? sp.writeLength : sp.readLength) = (length & 0xFFF00000) | 0xFF8;
+
+    // eight bytes per RCP cycle and a few cycles to set up each row
+    beginTransfer(Device::Signal, (static_cast<u64>(rows) * (size / 8 + signalRowSetup)) * 3 / 2);
+}
+
+u64 Memory::parallelCycles(u32 length) const {
+    const ParallelDom &dom = parallelInterface.dom1;
 
-    assert(region.type != MemoryRegion::Type::Empty);
+    // each page of the domain costs its latency, each halfword a strobe pulse and release, all in RCP cycles
+    u64 page = 1ull << ((dom.pageSize & 0xF) + 2);
+    u64 pages = (length + page - 1) / page;
+    u64 halfwords = (length + 1) / 2;
+    u64 rcp = pages * ((dom.latency & 0xFF) + 1) + halfwords * ((dom.pulseWidth & 0xFF) + (dom.release & 0xF) + 2);
 
-    switch (region.type) {
+    // the RCP runs at 62.5 MHz against the cpu's 93.75
+    return rcp * 3 / 2;
+}
+
+void Memory::startParallel(bool toCart) {
+    ParallelInterface &pi = parallelInterface;
+
+    if (pi.status & ParallelInterface::busy) {
+        pi.status |= ParallelInterface::error;
+        return;
+    }
+
+    u32 length = ((toCart ? pi.readLength : pi.writeLength) & 0x00FFFFFF) + 1;
+    u32 dram = pi.dramAddress & 0x00FFFFFE;
+    u32 cart = pi.cartAddress & 0xFFFFFFFE;
+
+    // nothing writable sits on the bus yet, so only the cart to RDRAM direction moves data
+    if (!toCart && dram < ram.size()) {
+        u32 span = static_cast<u32>(std::min<u64>(length, ram.size() - dram));
+
+        for (u32 page = dram >> pageBits; page <= (dram + span - 1) >> pageBits; page++)
+            release(page << pageBits);
+
+        u8 *target = ram.data() + dram;
+        u32 copied = 0;
+
+        if (cart >= romStart && cart - romStart < static_cast<u64>(rom.size())) {
+            copied = static_cast<u32>(std::min<u64>(span, rom.size() - (cart - romStart)));
+            std::memcpy(target, rom.data() + (cart - romStart), copied);
+        } else {
+            logUnimplemented(LogKind::Read, cart);
+        }
+
+        // open bus past the end of the image, reads back as zero here
+        std::memset(target + copied, 0, span - copied);
+    } else if (toCart) {
+        logUnimplemented(LogKind::Write, cart);
+    }
+
+    pi.dramAddress = (dram + length + 1) & ~1u;
+    pi.cartAddress = (cart + length + 1) & ~1u;
+    pi.status |= ParallelInterface::busy;
+
+    beginTransfer(Device::Parallel, parallelCycles(length));
+}
+
+u8 Memory::getByteSlow(u32 address) {
+    const MemoryPage &page = pages[address >> pageBits];
+    u32 subAddress = page.address | (address & pageMask);
+
+    const MemoryRegion *region = pageRegion(page.readSlot, subAddress, MemoryRegion::Intention::Read);
+
+    // nothing mapped reads as zero, like the Dummy regions
+    if (!region)
+        return unimplementedRead(address);
+
+    switch (region->type) {
+        case MemoryRegion::Type::ReadOnlyData:
+        case MemoryRegion::Type::ReadWriteData:
+            return region->data[subAddress - region->start];
+        case MemoryRegion::Type::Device: {
+            u64 value;
+            return readDevice(address, 1, value) ? static_cast<u8>(value) : unimplementedRead(address);
+        }
+        default:
+            return unimplementedRead(address);
+    }
+}
+
+void Memory::setByteSlow(u32 address, u8 value) {
+    const MemoryPage &page = pages[address >> pageBits];
+    u32 subAddress = page.address | (address & pageMask);
+
+    const MemoryRegion *region = pageRegion(page.writeSlot, subAddress, MemoryRegion::Intention::Write);
+
+    if (!region) {
+        unimplementedWrite(address, value);
+        return;
+    }
+
+    switch (region->type) {
         case MemoryRegion::Type::ReadWriteData:
-            region.data[subAddress - region.start] = value;
+            release(subAddress);
+            region->data[subAddress - region->start] = value;
             break;
-        case MemoryRegion::Type::WriteOnlyDevice:
-        case MemoryRegion::Type::ReadWriteDevice:
-            region.writeDevice(subAddress, value);
+        case MemoryRegion::Type::Device:
+            if (!writeDevice(address, 1, value))
+                unimplementedWrite(address, value);
             break;
-        case MemoryRegion::Type::Dummy:
+        default:
             unimplementedWrite(address, value);
             break;
-        default:
-            assert(false);
     }
 }
 
-Memory::Memory(const Rom &rom) : rom(rom), ram(mb(4)), spMemory(kb(8)) {
+Memory::Memory(const Rom &rom)
+    : pages(static_cast<MemoryPage *>(std::calloc(pageCount, sizeof(MemoryPage))), std::free),
+    watched(0x20000000 >> pageBits), clean(0x20000000 >> pageBits), ram(ramSize), spMemory(spMemorySize), rom(rom) {
+    assert(pages);
+
     std::memcpy(spMemory.data(), &rom.header, sizeof(Header));
 
+    // the boot code programs domain 1 timing from the first word of the image
+    u32 timing = rom.header.magic.get();
+    parallelInterface.dom1.latency = timing & 0xFF;
+    parallelInterface.dom1.pulseWidth = (timing >> 8) & 0xFF;
+    parallelInterface.dom1.pageSize = (timing >> 16) & 0xF;
+    parallelInterface.dom1.release = (timing >> 20) & 0x3;
+
     regions = {
         MemoryRegion(0x00000000, ram.size(), ram.data()),
         MemoryRegion(0x04000000, spMemory.size(), spMemory.data()),
-        MemoryRegion(0x03F00000, sizeof(RamRegisters), &ramRegisters),
+        MemoryRegion(0x03F00000, sizeof(RamRegisters), Device::RamRegisters),
         MemoryRegion(0x03F00000 + sizeof(RamRegisters), 0x00100000 - sizeof(RamRegisters)),
-        MemoryRegion(0x04040000, sizeof(SignalRegisters), &signalRegisters),
-        MemoryRegion(0x04300000, sizeof(MipsInterface), &mipsInterface),
-        MemoryRegion(0x04700000, sizeof(RamInterface), &ramInterface),
-        MemoryRegion(0x10000000, sizeof(Header), &rom.header),
-        MemoryRegion(0x04600000, sizeof(ParallelInterface), &parallelInterface),
+        MemoryRegion(0x04040000, sizeof(SignalRegisters), Device::Signal),
+        MemoryRegion(0x04300000, sizeof(MipsInterface), Device::Mips),
+        MemoryRegion(0x04700000, sizeof(RamInterface), Device::RamInterface),
+        MemoryRegion(romStart, static_cast<u32>(std::min<u64>(rom.size(), romLimit)), rom.data()),
+        MemoryRegion(pifRamStart, pifRam.size(), pifRam.data()),
+        MemoryRegion(0x04600000, sizeof(ParallelInterface), Device::Parallel),
         MemoryRegion(0x80000000, 0x20000000, u32(0x00000000)),
         MemoryRegion(0xA0000000, 0x20000000, u32(0x00000000)),
     };
-}
\ No newline at end of file
+
+    buildPages();
+}
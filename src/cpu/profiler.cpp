@@ -0,0 +1,209 @@
+#include <cpu/profiler.h>
+
+#include <cpu/cpu.h>
+
+#include <fmt/printf.h>
+
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// older headers only name the union member
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+#endif
+
+static constexpr ssi reportRows = 20;
+
+// the profiler of the cpu running on this thread, the timer only ever signals the thread that armed it
+static thread_local Profiler *active = nullptr;
+
+void Profiler::sample(int) {
+    if (!active)
+        return;
+
+    BlockProfile *profile = active->current;
+
+    if (profile)
+        profile->samples = profile->samples + 1;
+    else
+        active->outside = active->outside + 1;
+}
+
+void Profiler::fold(BlockProfile &profile) {
+    for (u16 opcode : profile.opcodes)
+        opcodes[opcode] += profile.pending;
+
+    profile.pending = 0;
+}
+
+BlockProfile *Profiler::attach(u32 physical, u32 address, const std::vector<Instruction> &instructions) {
+    BlockProfile &profile = blocks[physical];
+
+    fold(profile);
+
+    profile.address = address;
+    profile.length = instructions.size();
+    profile.opcodes.clear();
+
+    for (const Instruction &instruction : instructions)
+        profile.opcodes.push_back(instruction.opcode);
+
+    return &profile;
+}
+
+// Names an address by where it came from: the bootstrap in SP memory or the cartridge image loaded at boot.
+static std::string symbolize(u32 address, u32 boot, ssi rom) {
+    // KSEG0 and KSEG1 both map straight onto physical memory
+    bool direct = address >= 0x80000000 && address < 0xC0000000;
+    u32 physical = direct ? address & 0x1FFFFFFF : address;
+    u32 loaded = boot & 0x1FFFFFFF;
+
+    constexpr u32 spStart = 0x04000000;
+    constexpr u32 cartLoad = 0x1000; // the boot code copies the cartridge from here on to the boot address
+
+    if (physical >= spStart && physical < spStart + sizeof(Header))
+        return fmt::format("ipl+0x{:x}", physical - spStart);
+
+    if (rom > cartLoad && physical >= loaded && physical - loaded < rom - cartLoad)
+        return fmt::format("rom+0x{:x}", physical - loaded + cartLoad);
+
+    return "?";
+}
+
+void Profiler::write(u32 boot, ssi rom) {
+    std::FILE *file = settings.output.empty() ? stdout : std::fopen(settings.output.c_str(), "w");
+
+    if (!file) {
+        fmt::print("Could not open {} for the profile.\n", settings.output);
+        return;
+    }
+
+    std::vector<BlockProfile *> hot;
+    u64 total = 0;
+    u64 samples = outside;
+
+    for (auto &entry : blocks) {
+        fold(entry.second);
+
+        hot.push_back(&entry.second);
+        total += entry.second.executions * entry.second.length;
+        samples += entry.second.samples;
+    }
+
+    auto share = [](u64 part, u64 whole) { return whole ? part * 100.0 / whole : 0.0; };
+
+    fmt::print(file, "Profile: {} guest instructions in {} blocks, {} host samples at {} Hz.\n",
+        total, blocks.size(), samples, settings.frequency);
+
+    std::sort(hot.begin(), hot.end(), [](const BlockProfile *a, const BlockProfile *b) {
+        return a->executions * a->length > b->executions * b->length;
+    });
+
+    fmt::print(file, "\nBlocks by guest instructions\n{:>8} {:>14} {:>12} {:>10}  {}\n",
+        "share", "instructions", "executions", "address", "symbol");
+    for (ssi a = 0; a < std::min(reportRows, hot.size()); a++) {
+        const BlockProfile &profile = *hot[a];
+        u64 instructions = profile.executions * profile.length;
+
+        fmt::print(file, "{:>7.2f}% {:>14} {:>12} 0x{:0>8X}  {}\n", share(instructions, total),
+            instructions, profile.executions, profile.address, symbolize(profile.address, boot, rom));
+    }
+
+    std::sort(hot.begin(), hot.end(), [](const BlockProfile *a, const BlockProfile *b) {
+        return a->samples > b->samples;
+    });
+
+    fmt::print(file, "\nBlocks by host time\n{:>8} {:>10} {:>10}  {}\n", "share", "samples", "address", "symbol");
+    fmt::print(file, "{:>7.2f}% {:>10} {:>10}  {}\n", share(outside, samples), u64(outside), "", "(outside blocks)");
+    for (ssi a = 0; a < std::min(reportRows, hot.size()) && hot[a]->samples; a++) {
+        const BlockProfile &profile = *hot[a];
+
+        fmt::print(file, "{:>7.2f}% {:>10} 0x{:0>8X}  {}\n", share(profile.samples, samples),
+            u64(profile.samples), profile.address, symbolize(profile.address, boot, rom));
+    }
+
+    u64 executed = 0;
+
+    // reserved encodings all share one name, merge them
+    std::map<std::string, u64> named;
+    for (u16 opcode = 0; opcode < opcodes.size(); opcode++) {
+        executed += opcodes[opcode];
+
+        if (opcodes[opcode])
+            named[Cpu::opcodeName(opcode)] += opcodes[opcode];
+    }
+
+    std::vector<std::pair<std::string, u64>> ranked(named.begin(), named.end());
+    std::sort(ranked.begin(), ranked.end(), [](const std::pair<std::string, u64> &a, const std::pair<std::string, u64> &b) {
+        return a.second > b.second;
+    });
+
+    fmt::print(file, "\nOpcodes\n{:>8} {:>14}  {}\n", "share", "count", "name");
+    for (ssi a = 0; a < std::min(reportRows, ranked.size()); a++)
+        fmt::print(file, "{:>7.2f}% {:>14}  {}\n", share(ranked[a].second, executed), ranked[a].second, ranked[a].first);
+
+    std::vector<std::pair<std::string, u64>> missing(unimplemented.begin(), unimplemented.end());
+    std::sort(missing.begin(), missing.end(), [](const std::pair<std::string, u64> &a, const std::pair<std::string, u64> &b) {
+        return a.second > b.second;
+    });
+
+    fmt::print(file, "\nUnimplemented\n{:>14}  {}\n", "count", "name");
+    for (ssi a = 0; a < std::min(reportRows, missing.size()); a++)
+        fmt::print(file, "{:>14}  {}\n", missing[a].second, missing[a].first);
+
+    if (file != stdout)
+        std::fclose(file);
+}
+
+Profiler::Profiler(ProfileSettings settings)
+    : settings(std::move(settings)), opcodes(DispatchTable::levels * DispatchTable::entries) {
+    if (active || !this->settings.frequency)
+        return;
+
+#if defined(__linux__)
+    // left installed for good, a sample already on its way to another thread must not kill the process
+    std::signal(SIGPROF, sample);
+
+    // counts this thread's cpu time only, so other threads never land a sample on this cpu's blocks
+    sigevent event = {};
+    event.sigev_notify = SIGEV_THREAD_ID;
+    event.sigev_signo = SIGPROF;
+    event.sigev_notify_thread_id = static_cast<pid_t>(syscall(SYS_gettid));
+
+    if (timer_create(CLOCK_THREAD_CPUTIME_ID, &event, &timer) != 0) {
+        fmt::print("Could not create the profiling timer, no host samples will be taken.\n");
+        return;
+    }
+
+    active = this;
+    armed = true;
+
+    u64 interval = std::max<u64>(1000000000ull / this->settings.frequency, 1);
+
+    itimerspec spec = {};
+    spec.it_interval.tv_sec = interval / 1000000000ull;
+    spec.it_interval.tv_nsec = interval % 1000000000ull;
+    spec.it_value = spec.it_interval;
+    timer_settime(timer, 0, &spec, nullptr);
+#else
+    fmt::print("Host samples need a per thread timer, not taking any on this host.\n");
+#endif
+}
+
+Profiler::~Profiler() {
+    if (!armed)
+        return;
+
+#if defined(__linux__)
+    timer_delete(timer);
+#endif
+
+    if (active == this)
+        active = nullptr;
+}
@@ -0,0 +1,703 @@
+#include <cpu/recompiler.h>
+
+#include <cpu/cpu.h>
+
+#include <algorithm>
+#include <cstddef>
+
+#if defined(__x86_64__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+const void *CodeBuffer::write(const std::vector<u8> &code) {
+#if defined(__x86_64__)
+    if (!memory || used + code.size() > size) {
+        exhausted = true;
+        return nullptr;
+    }
+
+    // never writable and executable at the same time, only the pages the code lands on change
+    static const ssi page = static_cast<ssi>(sysconf(_SC_PAGESIZE));
+    ssi first = used & ~(page - 1);
+    ssi last = (used + code.size() + page - 1) & ~(page - 1);
+
+    mprotect(memory + first, last - first, PROT_READ | PROT_WRITE);
+    u8 *result = memory + used;
+    std::memcpy(result, code.data(), code.size());
+    mprotect(memory + first, last - first, PROT_READ | PROT_EXEC);
+
+    // keep entry points aligned
+    used = (used + code.size() + 15) & ~ssi(15);
+
+    return result;
+#else
+    return nullptr;
+#endif
+}
+
+void CodeBuffer::reset() {
+    used = 0;
+    exhausted = false;
+}
+
+CodeBuffer::CodeBuffer(ssi size) : size(size) {
+#if defined(__x86_64__)
+    void *result = mmap(nullptr, size, PROT_READ | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (result != MAP_FAILED)
+        memory = static_cast<u8 *>(result);
+#endif
+}
+
+CodeBuffer::~CodeBuffer() {
+#if defined(__x86_64__)
+    if (memory)
+        munmap(memory, size);
+#endif
+}
+
+static void executeHandler(Cpu *cpu, Registers *registers, const Instruction *instruction) {
+    (cpu->*instruction->handler)(*instruction);
+    registers->regs[0] = 0;
+}
+
+static u64 readByte(Memory *memory, u32 address) { return memory->getByte(address); }
+static u64 readHalf(Memory *memory, u32 address) { return memory->get<u16>(address); }
+static u64 readWord(Memory *memory, u32 address) { return memory->get<u32>(address); }
+
+static void writeByte(Memory *memory, u32 address, u32 value) { memory->setByte(address, value); }
+static void writeHalf(Memory *memory, u32 address, u32 value) { memory->set<u16>(address, value); }
+static void writeWord(Memory *memory, u32 address, u32 value) { memory->set<u32>(address, value); }
+
+// Emits one block. Frame: [rsp] entry pc, [rsp + 8] branch taken, [rsp + 16] branch target,
+// [rsp + 24] entry cycles, [rsp + 32] padding to keep calls aligned.
+class Translation {
+    Emitter &emitter;
+    Cpu &cpu;
+    Registers &registers;
+    DelaySlot &slot;
+    Memory &memory;
+    u64 &cycles;
+    const Block &block;
+
+    static constexpr i32 frame = 40;
+
+    static constexpr Host none = Host::Rsp;
+    static constexpr Host saved[] = { Host::Rbx, Host::R12, Host::R13, Host::R14, Host::R15 };
+
+    Host cached[32];
+    Label epilogue;
+
+    static i32 guest(u8 index) {
+        return static_cast<i32>(offsetof(Registers, regs) + index * sizeof(i64));
+    }
+
+    void allocate();
+
+    void get(Host dest, u8 index);
+    void put(u8 index, Host src);
+    void flush();
+    void reload();
+
+    void pc(Host dest, i32 offset);
+    void charge(u32 count);
+    void exit(Host pc, u32 count);
+
+    void fallback(const Instruction &instruction, u32 offset);
+    void load(const Instruction &instruction, u32 size, bool unsignedOffset);
+    void store(const Instruction &instruction, u32 size);
+
+    bool special(const Instruction &instruction);
+    bool simple(const Instruction &instruction);
+    bool branch(const Instruction &instruction, u32 offset, const Instruction *delay);
+
+public:
+    bool emit();
+
+    Translation(Emitter &emitter, Cpu &cpu, Registers &registers, DelaySlot &slot, Memory &memory, u64 &cycles,
+        const Block &block)
+        : emitter(emitter), cpu(cpu), registers(registers), slot(slot), memory(memory), cycles(cycles), block(block) { }
+};
+
+constexpr i32 Translation::frame;
+constexpr Host Translation::none;
+constexpr Host Translation::saved[];
+
+// only the fields each format actually names as gprs, an i-type rd is just immediate bits
+static void countOperands(const Instruction &instruction, u32 *uses) {
+    switch (shift(instruction.word, 26, 6)) {
+        case 0b000000: // special
+            uses[instruction.rs]++;
+            uses[instruction.rt]++;
+            uses[instruction.rd]++;
+            break;
+        case 0b000001: // regimm, rt picks the operation
+            uses[instruction.rs]++;
+            if (instruction.rt & 0b10000)
+                uses[31]++;
+            break;
+        case 0b000010: // j
+            break;
+        case 0b000011: // jal
+            uses[31]++;
+            break;
+        case 0b010000: // cop0, rd names a cop0 register
+            uses[instruction.rt]++;
+            break;
+        case 0b000110: // blez
+        case 0b000111: // bgtz
+        case 0b010110: // blezl
+        case 0b010111: // bgtzl
+            uses[instruction.rs]++;
+            break;
+        default:
+            uses[instruction.rs]++;
+            uses[instruction.rt]++;
+            break;
+    }
+}
+
+void Translation::allocate() {
+    u32 uses[32] = { 0 };
+
+    for (const Instruction &instruction : block.instructions)
+        countOperands(instruction, uses);
+
+    // $zero always reads as zero, caching it would only waste a host register
+    uses[0] = 0;
+
+    std::fill(std::begin(cached), std::end(cached), none);
+
+    for (Host host : saved) {
+        u32 best = 1;
+
+        for (u32 a = 2; a < 32; a++) {
+            if (cached[a] == none && uses[a] > uses[best])
+                best = a;
+        }
+
+        if (uses[best] < 2)
+            break;
+
+        cached[best] = host;
+        uses[best] = 0;
+    }
+}
+
+void Translation::get(Host dest, u8 index) {
+    if (cached[index] != none)
+        emitter.mov(dest, cached[index]);
+    else
+        emitter.load(dest, Host::Rbp, guest(index));
+}
+
+void Translation::put(u8 index, Host src) {
+    if (index == 0)
+        return;
+
+    if (cached[index] != none)
+        emitter.mov(cached[index], src);
+    else
+        emitter.store(Host::Rbp, guest(index), src);
+}
+
+void Translation::flush() {
+    for (u32 a = 0; a < 32; a++) {
+        if (cached[a] != none)
+            emitter.store(Host::Rbp, guest(a), cached[a]);
+    }
+}
+
+void Translation::reload() {
+    for (u32 a = 0; a < 32; a++) {
+        if (cached[a] != none)
+            emitter.load(cached[a], Host::Rbp, guest(a));
+    }
+}
+
+void Translation::pc(Host dest, i32 offset) {
+    emitter.load(dest, Host::Rsp, 0);
+    if (offset)
+        emitter.alu(Alu::Add, dest, offset);
+}
+
+// cycles = entry + count, the same time the interpreter has after running count instructions
+void Translation::charge(u32 count) {
+    emitter.load(Host::Rcx, Host::Rsp, 24);
+    if (count)
+        emitter.alu(Alu::Add, Host::Rcx, static_cast<i32>(count));
+    emitter.mov(Host::Rdx, reinterpret_cast<u64>(&cycles));
+    emitter.store(Host::Rdx, 0, Host::Rcx);
+}
+
+// count is how many instructions ran on the way to this exit, a nullified delay slot isn't one of them
+void Translation::exit(Host pc, u32 count) {
+    emitter.store(Host::Rbp, offsetof(Registers, pc), pc);
+    charge(count);
+    emitter.jump(epilogue);
+}
+
+void Translation::fallback(const Instruction &instruction, u32 offset) {
+    flush();
+    charge(offset / sizeof(u32));
+
+    // handlers expect the pc of the instruction they run for
+    pc(Host::Rax, offset);
+    emitter.store(Host::Rbp, offsetof(Registers, pc), Host::Rax);
+
+    emitter.mov(Host::Rdi, reinterpret_cast<u64>(&cpu));
+    emitter.mov(Host::Rsi, reinterpret_cast<u64>(&registers));
+    emitter.mov(Host::Rdx, reinterpret_cast<u64>(&instruction));
+    emitter.call(reinterpret_cast<const void *>(executeHandler));
+
+    reload();
+}
+
+void Translation::load(const Instruction &instruction, u32 size, bool unsignedOffset) {
+    Label slow, done;
+
+    get(Host::Rax, instruction.rs);
+    emitter.alu(Alu::Add, Host::Rax, unsignedOffset ? static_cast<u16>(instruction.immediate) : instruction.immediate);
+    emitter.mov32(Host::Rcx, Host::Rax);
+
+    // rsi = pages[address >> pageBits].read
+    emitter.mov32(Host::Rdx, Host::Rcx);
+    emitter.shift32(Shift::Right, Host::Rdx, Memory::pageBits);
+    emitter.imul(Host::Rdx, Host::Rdx, sizeof(MemoryPage));
+    emitter.mov(Host::Rsi, reinterpret_cast<u64>(memory.pageTable()));
+    emitter.alu(Alu::Add, Host::Rsi, Host::Rdx);
+    emitter.load(Host::Rsi, Host::Rsi, offsetof(MemoryPage, read));
+    emitter.test(Host::Rsi, Host::Rsi);
+    emitter.jump(Condition::Equal, slow);
+
+    if (size > 1) {
+        emitter.test32(Host::Rcx, size - 1);
+        emitter.jump(Condition::NotEqual, slow);
+    }
+
+    emitter.mov32(Host::Rdx, Host::Rcx);
+    emitter.alu32(Alu::And, Host::Rdx, Memory::pageMask);
+
+    switch (size) {
+        case 1:
+            emitter.load8(Host::Rax, Host::Rsi, Host::Rdx);
+            break;
+        case 2:
+            emitter.load16(Host::Rax, Host::Rsi, Host::Rdx);
+            emitter.bswap32(Host::Rax);
+            emitter.shift32(Shift::Right, Host::Rax, 16);
+            break;
+        default:
+            emitter.load32(Host::Rax, Host::Rsi, Host::Rdx);
+            emitter.bswap32(Host::Rax);
+            break;
+    }
+
+    emitter.jump(done);
+
+    emitter.bind(slow);
+    emitter.mov(Host::Rdi, reinterpret_cast<u64>(&memory));
+    emitter.mov32(Host::Rsi, Host::Rcx);
+    emitter.call(reinterpret_cast<const void *>(size == 1 ? readByte : size == 2 ? readHalf : readWord));
+
+    emitter.bind(done);
+    put(instruction.rt, Host::Rax);
+
+    emitter.finish(slow);
+    emitter.finish(done);
+}
+
+void Translation::store(const Instruction &instruction, u32 size) {
+    Label slow, done;
+
+    get(Host::Rax, instruction.rs);
+    emitter.alu(Alu::Add, Host::Rax, instruction.immediate);
+    emitter.mov32(Host::Rcx, Host::Rax);
+    get(Host::R8, instruction.rt);
+
+    // rsi = pages[address >> pageBits].write
+    emitter.mov32(Host::Rdx, Host::Rcx);
+    emitter.shift32(Shift::Right, Host::Rdx, Memory::pageBits);
+    emitter.imul(Host::Rdx, Host::Rdx, sizeof(MemoryPage));
+    emitter.mov(Host::Rsi, reinterpret_cast<u64>(memory.pageTable()));
+    emitter.alu(Alu::Add, Host::Rsi, Host::Rdx);
+    emitter.load(Host::Rsi, Host::Rsi, offsetof(MemoryPage, write));
+    emitter.test(Host::Rsi, Host::Rsi);
+    emitter.jump(Condition::Equal, slow);
+
+    if (size > 1) {
+        emitter.test32(Host::Rcx, size - 1);
+        emitter.jump(Condition::NotEqual, slow);
+    }
+
+    emitter.mov32(Host::Rdx, Host::Rcx);
+    emitter.alu32(Alu::And, Host::Rdx, Memory::pageMask);
+    emitter.mov32(Host::Rax, Host::R8);
+
+    switch (size) {
+        case 1:
+            emitter.store8(Host::Rsi, Host::Rdx, Host::Rax);
+            break;
+        case 2:
+            emitter.bswap32(Host::Rax);
+            emitter.shift32(Shift::Right, Host::Rax, 16);
+            emitter.store16(Host::Rsi, Host::Rdx, Host::Rax);
+            break;
+        default:
+            emitter.bswap32(Host::Rax);
+            emitter.store32(Host::Rsi, Host::Rdx, Host::Rax);
+            break;
+    }
+
+    emitter.jump(done);
+
+    // watched pages land here too, the handler invalidates whatever was decoded from them
+    emitter.bind(slow);
+    emitter.mov(Host::Rdi, reinterpret_cast<u64>(&memory));
+    emitter.mov32(Host::Rsi, Host::Rcx);
+    emitter.mov32(Host::Rdx, Host::R8);
+    emitter.call(reinterpret_cast<const void *>(size == 1 ? writeByte : size == 2 ? writeHalf : writeWord));
+
+    emitter.bind(done);
+
+    emitter.finish(slow);
+    emitter.finish(done);
+}
+
+bool Translation::special(const Instruction &instruction) {
+    u8 rs = instruction.rs;
+    u8 rt = instruction.rt;
+    u8 rd = instruction.rd;
+
+    auto binary = [this, rs, rt, rd](Alu op) {
+        get(Host::Rax, rs);
+        get(Host::Rcx, rt);
+        emitter.alu(op, Host::Rax, Host::Rcx);
+        put(rd, Host::Rax);
+    };
+
+    auto compare = [this, rs, rt, rd](Condition condition) {
+        get(Host::Rax, rs);
+        get(Host::Rcx, rt);
+        emitter.alu(Alu::Cmp, Host::Rax, Host::Rcx);
+        emitter.set(condition, Host::Rax);
+        put(rd, Host::Rax);
+    };
+
+    auto multiply = [this, rs, rt](bool sign) {
+        get(Host::Rax, rs);
+        get(Host::Rcx, rt);
+
+        if (sign) {
+            emitter.movsxd(Host::Rax, Host::Rax);
+            emitter.movsxd(Host::Rcx, Host::Rcx);
+        } else {
+            emitter.mov32(Host::Rax, Host::Rax);
+            emitter.mov32(Host::Rcx, Host::Rcx);
+        }
+
+        emitter.imul(Host::Rax, Host::Rcx);
+        emitter.mov32(Host::Rcx, Host::Rax);
+        emitter.store(Host::Rbp, offsetof(Registers, lo), Host::Rcx);
+        emitter.shift(Shift::Right, Host::Rax, 32);
+        emitter.store(Host::Rbp, offsetof(Registers, hi), Host::Rax);
+    };
+
+    switch (shift(instruction.word, 0, 6)) {
+        case 0b100000: // add
+        case 0b100001: binary(Alu::Add); return true; // addu
+        case 0b100010: // sub
+        case 0b100011: binary(Alu::Sub); return true; // subu
+        case 0b100100: binary(Alu::And); return true;
+        case 0b100101: binary(Alu::Or); return true;
+        case 0b100110: binary(Alu::Xor); return true;
+        case 0b100111: // nor
+            binary(Alu::Or);
+            emitter.notq(Host::Rax);
+            put(rd, Host::Rax);
+            return true;
+        case 0b101010: compare(Condition::Less); return true; // slt
+        case 0b101011: compare(Condition::Below); return true; // sltu
+        case 0b011000: multiply(true); return true; // mult
+        case 0b011001: multiply(false); return true; // multu
+        case 0b010000: // mfhi
+            emitter.load(Host::Rax, Host::Rbp, offsetof(Registers, hi));
+            put(rd, Host::Rax);
+            return true;
+        case 0b010001: // mthi
+            get(Host::Rax, rs);
+            emitter.store(Host::Rbp, offsetof(Registers, hi), Host::Rax);
+            return true;
+        case 0b010010: // mflo
+            emitter.load(Host::Rax, Host::Rbp, offsetof(Registers, lo));
+            put(rd, Host::Rax);
+            return true;
+        case 0b010011: // mtlo
+            get(Host::Rax, rs);
+            emitter.store(Host::Rbp, offsetof(Registers, lo), Host::Rax);
+            return true;
+        case 0b000000: // sll
+        case 0b000010: // srl
+            get(Host::Rax, rt);
+            if (instruction.sa)
+                emitter.shift(instruction.word & 0b10 ? Shift::Right : Shift::Left, Host::Rax, instruction.sa);
+            put(rd, Host::Rax);
+            return true;
+        case 0b000100: // sllv
+        case 0b000110: // srlv
+            get(Host::Rax, rt);
+            get(Host::Rcx, rs);
+            emitter.shiftCl(instruction.word & 0b10 ? Shift::Right : Shift::Left, Host::Rax);
+            put(rd, Host::Rax);
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool Translation::simple(const Instruction &instruction) {
+    u8 rs = instruction.rs;
+    u8 rt = instruction.rt;
+    i32 value = instruction.immediate;
+    u16 unsignedValue = static_cast<u16>(instruction.immediate);
+
+    auto immediate = [this, rs, rt](Alu op, i32 value) {
+        get(Host::Rax, rs);
+        emitter.alu(op, Host::Rax, value);
+        put(rt, Host::Rax);
+    };
+
+    auto compare = [this, rs, rt](Condition condition, i32 value) {
+        get(Host::Rax, rs);
+        emitter.alu(Alu::Cmp, Host::Rax, value);
+        emitter.set(condition, Host::Rax);
+        put(rt, Host::Rax);
+    };
+
+    switch (shift(instruction.word, 26, 6)) {
+        case 0b000000: return special(instruction);
+        case 0b001000: // addi
+        case 0b001001: immediate(Alu::Add, value); return true; // addiu
+        case 0b001010: compare(Condition::Less, value); return true; // slti
+        case 0b001011: compare(Condition::Below, unsignedValue); return true; // sltiu
+        case 0b001100: immediate(Alu::And, unsignedValue); return true; // andi
+        case 0b001101: immediate(Alu::Or, unsignedValue); return true; // ori
+        case 0b001110: immediate(Alu::Xor, unsignedValue); return true; // xori
+        case 0b001111: // lui
+            emitter.mov(Host::Rax, static_cast<u64>(unsignedValue) << 16u);
+            put(rt, Host::Rax);
+            return true;
+        case 0b100000: load(instruction, 1, false); return true; // lb
+        case 0b100001: load(instruction, 2, false); return true; // lh
+        case 0b100011: load(instruction, 4, false); return true; // lw
+        case 0b100100: load(instruction, 1, true); return true; // lbu
+        case 0b100101: load(instruction, 2, false); return true; // lhu
+        case 0b101000: store(instruction, 1); return true; // sb
+        case 0b101001: store(instruction, 2); return true; // sh
+        case 0b101011: store(instruction, 4); return true; // sw
+        default: return false;
+    }
+}
+
+bool Translation::branch(const Instruction &instruction, u32 offset, const Instruction *delay) {
+    u32 op = shift(instruction.word, 26, 6);
+    u32 func = shift(instruction.word, 0, 6);
+    u32 regimm = instruction.rt;
+
+    // target in rax
+    if (op == 0b000000) {
+        get(Host::Rax, instruction.rs);
+    } else if (op == 0b000010 || op == 0b000011) {
+        pc(Host::Rax, offset);
+        emitter.alu32(Alu::And, Host::Rax, static_cast<i32>(0xF0000000u));
+        emitter.alu32(Alu::Or, Host::Rax, shift(instruction.word, 0, 26) * sizeof(u32));
+    } else {
+        pc(Host::Rax, offset + (instruction.immediate + 1) * sizeof(u32));
+    }
+
+    emitter.store(Host::Rsp, 16, Host::Rax);
+
+    // links are written before the condition is read, same as the handlers
+    bool link = op == 0b000011 || (op == 0b000001 && (regimm & 0b10000)) || (op == 0b000000 && func == 0b001001);
+    if (link) {
+        pc(Host::Rcx, offset + 2 * sizeof(u32));
+        put(op == 0b000000 ? instruction.rd : static_cast<u8>(RegisterIndex::Link), Host::Rcx);
+    }
+
+    // taken in rcx
+    auto zero = [this, &instruction](Condition condition) {
+        get(Host::Rax, instruction.rs);
+        emitter.alu(Alu::Cmp, Host::Rax, 0);
+        emitter.set(condition, Host::Rcx);
+    };
+
+    auto equal = [this, &instruction](Condition condition) {
+        get(Host::Rax, instruction.rt);
+        get(Host::Rdx, instruction.rs);
+        emitter.alu(Alu::Cmp, Host::Rax, Host::Rdx);
+        emitter.set(condition, Host::Rcx);
+    };
+
+    // the likely forms differ from the plain ones by a single opcode bit
+    bool likely = op >= 0b010100 && op <= 0b010111;
+
+    switch (likely ? op & 0b000111 : op) {
+        case 0b000000: // jr, jalr
+        case 0b000010: // j
+        case 0b000011: // jal
+            emitter.mov(Host::Rcx, 1);
+            break;
+        case 0b000001: // bltz, bgez, bltzal, bgezal
+            if (regimm & 0b01110)
+                return false;
+            zero(regimm & 1 ? Condition::GreaterEqual : Condition::Less);
+            break;
+        case 0b000100: equal(Condition::Equal); break; // beq, beql
+        case 0b000101: equal(Condition::NotEqual); break; // bne, bnel
+        case 0b000110: zero(Condition::LessEqual); break; // blez, blezl
+        case 0b000111: zero(Condition::Greater); break; // bgtz, bgtzl
+        default: return false;
+    }
+
+    emitter.store(Host::Rsp, 8, Host::Rcx);
+
+    Label nullified;
+    if (likely) {
+        emitter.test(Host::Rcx, Host::Rcx);
+        emitter.jump(Condition::Equal, nullified);
+    }
+
+    Label taken;
+
+    if (delay) {
+        if (!simple(*delay))
+            fallback(*delay, offset + sizeof(u32));
+
+        emitter.load(Host::Rcx, Host::Rsp, 8);
+        emitter.test(Host::Rcx, Host::Rcx);
+        emitter.jump(Condition::NotEqual, taken);
+
+        pc(Host::Rax, offset + 2 * sizeof(u32));
+        exit(Host::Rax, offset / sizeof(u32) + 2);
+
+        emitter.bind(taken);
+        emitter.load(Host::Rax, Host::Rsp, 16);
+        exit(Host::Rax, offset / sizeof(u32) + 2);
+    } else {
+        // the delay slot starts the next block, leave the branch pending like the handlers do
+        emitter.test(Host::Rcx, Host::Rcx);
+        emitter.jump(Condition::Equal, taken);
+
+        emitter.mov(Host::Rdx, reinterpret_cast<u64>(&slot));
+        emitter.store8(Host::Rdx, offsetof(DelaySlot, pending), 1);
+        emitter.load(Host::Rax, Host::Rsp, 16);
+        emitter.store(Host::Rdx, offsetof(DelaySlot, target), Host::Rax);
+
+        emitter.bind(taken);
+        pc(Host::Rax, offset + sizeof(u32));
+        exit(Host::Rax, offset / sizeof(u32) + 1);
+    }
+
+    emitter.finish(taken);
+
+    if (likely) {
+        emitter.bind(nullified);
+        pc(Host::Rax, offset + 2 * sizeof(u32));
+        exit(Host::Rax, offset / sizeof(u32) + 1);
+        emitter.finish(nullified);
+    }
+
+    return true;
+}
+
+bool Translation::emit() {
+    allocate();
+
+    emitter.push(Host::Rbp);
+    for (Host host : saved)
+        emitter.push(host);
+    emitter.alu(Alu::Sub, Host::Rsp, frame);
+
+    emitter.mov(Host::Rbp, reinterpret_cast<u64>(&registers));
+    emitter.load(Host::Rax, Host::Rbp, offsetof(Registers, pc));
+    emitter.store(Host::Rsp, 0, Host::Rax);
+    emitter.mov(Host::Rax, reinterpret_cast<u64>(&cycles));
+    emitter.load(Host::Rax, Host::Rax, 0);
+    emitter.store(Host::Rsp, 24, Host::Rax);
+
+    reload();
+
+    const std::vector<Instruction> &instructions = block.instructions;
+    bool ended = false;
+
+    for (u32 a = 0; a < instructions.size(); a++) {
+        const Instruction &instruction = instructions[a];
+        u32 offset = a * sizeof(u32);
+
+        if (instruction.branch) {
+            const Instruction *delay = a + 1 < instructions.size() ? &instructions[a + 1] : nullptr;
+
+            // a branch in a delay slot is left to the interpreter
+            if (delay && delay->branch)
+                return false;
+
+            if (!branch(instruction, offset, delay))
+                return false;
+
+            ended = true;
+            break;
+        }
+
+        if (!simple(instruction))
+            fallback(instruction, offset);
+    }
+
+    if (!ended) {
+        pc(Host::Rax, block.size);
+        exit(Host::Rax, static_cast<u32>(instructions.size()));
+    }
+
+    emitter.bind(epilogue);
+    flush();
+    emitter.alu(Alu::Add, Host::Rsp, frame);
+    for (u32 a = sizeof(saved) / sizeof(Host); a > 0; a--)
+        emitter.pop(saved[a - 1]);
+    emitter.pop(Host::Rbp);
+    emitter.ret();
+
+    emitter.finish(epilogue);
+
+    return true;
+}
+
+bool Recompiler::supported() {
+#if defined(__x86_64__)
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool Recompiler::emit(Emitter &emitter, const Block &block) {
+    return Translation(emitter, cpu, registers, slot, memory, cycles, block).emit();
+}
+
+Block::Code Recompiler::compile(const Block &block) {
+    if (!supported() || !buffer.valid())
+        return nullptr;
+
+    Emitter emitter;
+
+    if (!emit(emitter, block))
+        return nullptr;
+
+    return reinterpret_cast<Block::Code>(const_cast<void *>(buffer.write(emitter.code)));
+}
+
+void Recompiler::reset() {
+    buffer.reset();
+}
+
+Recompiler::Recompiler(Cpu &cpu, Registers &registers, DelaySlot &slot, Memory &memory, u64 &cycles)
+    : cpu(cpu), registers(registers), slot(slot), memory(memory), cycles(cycles), buffer(mb(32)) { }
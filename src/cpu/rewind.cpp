@@ -0,0 +1,89 @@
+#include <cpu/rewind.h>
+
+ssi RewindPoint::bytes() const {
+    ssi result = sizeof(RewindPoint) + registerBlocks.size() + deltas.size() * sizeof(PageDelta);
+
+    for (const PageDelta &delta : deltas)
+        result += delta.packed.size();
+
+    return result;
+}
+
+void RewindBuffer::push(Snapshot snapshot) {
+    if (filled) {
+        RewindPoint point;
+
+        point.registers = latest.registers;
+        point.slot = latest.slot;
+        point.cop0 = latest.cop0;
+        point.cycles = latest.cycles;
+        point.idle = latest.idle;
+        point.rsp = latest.rsp;
+        point.registerBlocks = std::move(latest.memory.registers);
+
+        const std::vector<std::shared_ptr<const PageData>> &before = latest.memory.pages;
+        const std::vector<std::shared_ptr<const PageData>> &after = snapshot.memory.pages;
+
+        // pages nobody wrote are still the same shared copy
+        for (u32 a = 0; a < after.size(); a++) {
+            if (before[a] == after[a])
+                continue;
+
+            for (u32 b = 0; b < scratch.size(); b++)
+                scratch[b] = (*before[a])[b] ^ (*after[a])[b];
+
+            PageDelta delta;
+            delta.index = a;
+            packBits(scratch.data(), scratch.size(), delta.packed);
+            delta.packed.shrink_to_fit();
+
+            point.deltas.push_back(std::move(delta));
+        }
+
+        used += point.bytes();
+        history.push_back(std::move(point));
+
+        while (!history.empty() && used > settings.capacity) {
+            used -= history.front().bytes();
+            history.pop_front();
+        }
+    }
+
+    latest = std::move(snapshot);
+    filled = true;
+}
+
+void RewindBuffer::drop() {
+    if (history.empty()) {
+        latest = Snapshot();
+        filled = false;
+        return;
+    }
+
+    RewindPoint &point = history.back();
+    used -= point.bytes();
+
+    latest.registers = point.registers;
+    latest.slot = point.slot;
+    latest.cop0 = point.cop0;
+    latest.cycles = point.cycles;
+    latest.idle = point.idle;
+    latest.rsp = point.rsp;
+    latest.memory.registers = std::move(point.registerBlocks);
+
+    for (const PageDelta &delta : point.deltas) {
+        bool valid = unpackBits(delta.packed.data(), delta.packed.size(), scratch.data(), scratch.size());
+        assert(valid);
+        (void)valid;
+
+        auto page = std::make_shared<PageData>(*latest.memory.pages[delta.index]);
+        for (u32 a = 0; a < scratch.size(); a++)
+            (*page)[a] ^= scratch[a];
+
+        latest.memory.pages[delta.index] = std::move(page);
+    }
+
+    history.pop_back();
+}
+
+RewindBuffer::RewindBuffer(const RewindSettings &settings) : settings(settings) { }
@@ -0,0 +1,210 @@
+#include <cpu/rsp.h>
+
+#include <util/log.h>
+
+#include <cstring>
+
+void Rsp::post(const RspMessage &message) {
+    // a handful of messages per task, a threaded rsp empties the inbox long before it fills
+    while (!inbox.push(message)) {
+        if (thread.joinable())
+            std::this_thread::yield();
+        else
+            receive();
+    }
+
+    if (thread.joinable()) {
+        // taking the lock orders the push before the rsp's last look at the inbox
+        { std::lock_guard<std::mutex> lock(parkMutex); }
+        parked.notify_one();
+    }
+}
+
+void Rsp::receive() {
+    RspMessage message;
+
+    while (inbox.pop(message)) {
+        switch (message.signal) {
+            case RspSignal::Start:
+                running = true;
+                taskEpoch = message.epoch;
+                clock = message.time;
+                code = message.code;
+                break;
+            case RspSignal::Halt:
+                running = false;
+                break;
+            case RspSignal::Reset:
+                running = message.running;
+                taskEpoch = message.epoch;
+                clock = message.time;
+                code = message.code;
+                break;
+            case RspSignal::Quit:
+                quitting = true;
+                break;
+            default:
+                break;
+        }
+
+        rspClock.store(clock, std::memory_order_release);
+    }
+}
+
+void Rsp::advance(u64 limit) {
+    while (running && clock < limit) {
+        // where an interpreter goes, for now the task ends on its first instruction
+        const RspCode &imem = *code;
+        u32 word = static_cast<u32>(imem[0]) << 24 | imem[1] << 16 | imem[2] << 8 | imem[3];
+        logUnimplemented(LogKind::Instruction, word, 0, "RSP");
+
+        clock++;
+        running = false;
+        code.reset();
+
+        RspMessage message;
+        message.signal = RspSignal::Break;
+        message.epoch = taskEpoch;
+        message.time = clock;
+
+        // the cpu drains the outbox at every sync, so it only fills if the cpu stops syncing
+        while (!outbox.push(message) && !quitting)
+            std::this_thread::yield();
+    }
+
+    rspClock.store(clock, std::memory_order_release);
+}
+
+void Rsp::loop() {
+    while (true) {
+        receive();
+
+        if (quitting)
+            return;
+
+        if (!running) {
+            std::unique_lock<std::mutex> lock(parkMutex);
+            parked.wait(lock, [this] { return !inbox.empty(); });
+            continue;
+        }
+
+        u64 limit = cpuClock.load(std::memory_order_acquire) + settings.slack;
+
+        if (clock >= limit) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        advance(limit);
+    }
+}
+
+bool Rsp::collect() {
+    bool broke = false;
+    RspMessage message;
+
+    while (outbox.pop(message)) {
+        if (message.signal == RspSignal::Break && message.epoch == epoch) {
+            busy = false;
+            broke = true;
+        }
+    }
+
+    return broke;
+}
+
+static std::shared_ptr<const RspCode> copyCode(const u8 *imem) {
+    auto code = std::make_shared<RspCode>();
+    std::memcpy(code->data(), imem, code->size());
+    return code;
+}
+
+void Rsp::start(u64 time, const u8 *imem) {
+    busy = true;
+    epoch++;
+    started = time;
+
+    // until the rsp picks the task up it counts as starting now, not wherever it last stopped
+    rspClock.store(time, std::memory_order_release);
+
+    RspMessage message;
+    message.signal = RspSignal::Start;
+    message.epoch = epoch;
+    message.time = time;
+    message.code = copyCode(imem);
+    post(message);
+}
+
+void Rsp::halt(u64 time) {
+    busy = false;
+
+    RspMessage message;
+    message.signal = RspSignal::Halt;
+    message.epoch = epoch;
+    message.time = time;
+    post(message);
+}
+
+bool Rsp::sync(u64 time) {
+    cpuClock.store(time, std::memory_order_release);
+
+    if (!thread.joinable()) {
+        receive();
+        advance(time);
+
+        return collect();
+    }
+
+    bool broke = collect();
+
+    while (busy && rspClock.load(std::memory_order_acquire) + settings.slack < time) {
+        std::this_thread::yield();
+        broke |= collect();
+    }
+
+    return broke;
+}
+
+RspState Rsp::state() const {
+    RspState result;
+    result.active = busy;
+    result.start = started;
+
+    return result;
+}
+
+void Rsp::reset(const RspState &state, u64 time, const u8 *imem) {
+    busy = state.active;
+    epoch++;
+    started = state.active ? state.start : time;
+
+    cpuClock.store(time, std::memory_order_release);
+    rspClock.store(started, std::memory_order_release);
+
+    RspMessage message;
+    message.signal = RspSignal::Reset;
+    message.running = state.active;
+    message.epoch = epoch;
+    message.time = started;
+    if (state.active)
+        message.code = copyCode(imem);
+    post(message);
+
+    collect();
+}
+
+Rsp::Rsp(const RspSettings &settings) : settings(settings) {
+    if (settings.threaded)
+        thread = std::thread([this] { loop(); });
+}
+
+Rsp::~Rsp() {
+    if (!thread.joinable())
+        return;
+
+    RspMessage message;
+    message.signal = RspSignal::Quit;
+    post(message);
+
+    thread.join();
+}
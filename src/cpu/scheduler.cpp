@@ -0,0 +1,45 @@
+#include <cpu/scheduler.h>
+
+#include <algorithm>
+
+constexpr u64 Scheduler::never;
+
+static bool later(const Event &a, const Event &b) {
+    return a.time > b.time;
+}
+
+void Scheduler::schedule(EventType type, u64 time) {
+    cancel(type);
+
+    Event event;
+    event.time = time;
+    event.type = type;
+
+    events.push_back(event);
+    std::push_heap(events.begin(), events.end(), later);
+}
+
+void Scheduler::cancel(EventType type) {
+    auto iterator = std::find_if(events.begin(), events.end(), [type](const Event &event) {
+        return event.type == type;
+    });
+
+    if (iterator == events.end())
+        return;
+
+    // only a handful of event types, rebuilding is cheaper than tracking heap positions
+    events.erase(iterator);
+    std::make_heap(events.begin(), events.end(), later);
+}
+
+bool Scheduler::pop(u64 now, EventType &type) {
+    if (events.empty() || events.front().time > now)
+        return false;
+
+    type = events.front().type;
+
+    std::pop_heap(events.begin(), events.end(), later);
+    events.pop_back();
+
+    return true;
+}
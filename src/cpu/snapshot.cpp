@@ -0,0 +1,293 @@
+#include <cpu/snapshot.h>
+#include <cpu/rewind.h>
+#include <cpu/rsp.h>
+
+#include <fmt/printf.h>
+
+#include <algorithm>
+#include <fstream>
+
+static constexpr char magic[8] = { 'S', 'C', 'O', 'U', 'T', 'S', 'A', 'V' };
+static constexpr u32 version = 7;
+
+static constexpr u32 compressedFlag = 1;
+
+enum class PageEncoding : u8 {
+    Zero,
+    Raw,
+    Packed,
+};
+
+Snapshot Cpu::snapshot() {
+    Snapshot result;
+
+    result.registers = registers;
+    result.slot = slot;
+    result.cop0 = cop0;
+    result.cycles = cycles;
+    result.idle = idleStats;
+    result.rsp = rsp->state();
+    result.memory = memory.capture();
+
+    return result;
+}
+
+void Cpu::restore(const Snapshot &snapshot) {
+    u64 spentCycles = cycles;
+    u64 spentInstructions = executed();
+
+    registers = snapshot.registers;
+    slot = snapshot.slot;
+    cop0 = snapshot.cop0;
+    cycles = snapshot.cycles;
+    idleStats = snapshot.idle;
+
+    memory.restore(snapshot.memory);
+
+    if (limits.cycles)
+        limits.cycles = limits.cycles - std::min(limits.cycles, spentCycles) + cycles;
+    if (limits.instructions)
+        limits.instructions = limits.instructions - std::min(limits.instructions, spentInstructions) + executed();
+
+    scheduleCompare();
+    scheduleStop();
+    scheduleRewind();
+    scheduleTransfers();
+    // anything the state left pending gets its look at the next block
+    scheduler.schedule(EventType::Interrupt, cycles);
+
+    rsp->reset(snapshot.rsp, cycles, memory.signalMemory() + kb(4));
+    scheduleRsp();
+}
+
+bool Cpu::rewind(u32 points) {
+    if (!history)
+        return false;
+
+    // anything recorded at or after the current time is the present, not history
+    while (!history->empty() && history->newest().cycles >= cycles)
+        history->drop();
+
+    for (u32 a = 1; a < points && history->size() > 1; a++)
+        history->drop();
+
+    if (history->empty())
+        return false;
+
+    restore(history->newest());
+
+    return true;
+}
+
+class Writer {
+public:
+    std::vector<u8> data;
+
+    void bytes(const void *value, ssi size) {
+        const u8 *start = static_cast<const u8 *>(value);
+        data.insert(data.end(), start, start + size);
+    }
+
+    template <typename T>
+    void put(T value) {
+        for (ssi a = 0; a < sizeof(T); a++)
+            data.push_back(static_cast<u8>(static_cast<u64>(value) >> (a * 8)));
+    }
+};
+
+class Reader {
+    const std::vector<u8> &data;
+    ssi offset = 0;
+
+public:
+    bool failed = false;
+
+    bool bytes(void *value, ssi size) {
+        if (failed || data.size() - offset < size) {
+            failed = true;
+            return false;
+        }
+
+        std::memcpy(value, data.data() + offset, size);
+        offset += size;
+
+        return true;
+    }
+
+    template <typename T>
+    T get() {
+        u8 raw[sizeof(T)] = {};
+        bytes(raw, sizeof(T));
+
+        u64 value = 0;
+        for (ssi a = 0; a < sizeof(T); a++)
+            value |= static_cast<u64>(raw[a]) << (a * 8);
+
+        return static_cast<T>(value);
+    }
+
+    explicit Reader(const std::vector<u8> &data) : data(data) { }
+};
+
+bool saveSnapshot(const Snapshot &snapshot, const std::string &path, bool compress) {
+    Writer writer;
+
+    writer.bytes(magic, sizeof(magic));
+    writer.put<u32>(version);
+    writer.put<u32>(compress ? compressedFlag : 0);
+
+    for (i64 value : snapshot.registers.regs)
+        writer.put<u64>(value);
+
+    writer.put<u64>(snapshot.registers.hi);
+    writer.put<u64>(snapshot.registers.lo);
+    writer.put<u64>(snapshot.registers.pc);
+    writer.put<u64>(snapshot.registers.llb);
+
+    writer.put<u8>(snapshot.slot.pending);
+    writer.put<u64>(snapshot.slot.target);
+
+    for (u32 value : snapshot.cop0.regs)
+        writer.put<u32>(value);
+
+    writer.put<u64>(snapshot.cop0.countStart);
+    writer.put<u64>(snapshot.cycles);
+    writer.put<u64>(snapshot.idle.loops);
+    writer.put<u64>(snapshot.idle.skips);
+    writer.put<u64>(snapshot.idle.cycles);
+
+    writer.put<u8>(snapshot.rsp.active);
+    writer.put<u64>(snapshot.rsp.start);
+
+    // already little endian field by field, see MemoryState
+    writer.put<u32>(snapshot.memory.registers.size());
+    writer.bytes(snapshot.memory.registers.data(), snapshot.memory.registers.size());
+
+    writer.put<u32>(snapshot.memory.pages.size());
+
+    std::vector<u8> packed;
+
+    for (const std::shared_ptr<const PageData> &page : snapshot.memory.pages) {
+        if (std::all_of(page->begin(), page->end(), [](u8 value) { return value == 0; })) {
+            writer.put<u8>(static_cast<u8>(PageEncoding::Zero));
+            continue;
+        }
+
+        packed.clear();
+        if (compress)
+            packBits(page->data(), page->size(), packed);
+
+        if (compress && packed.size() < page->size()) {
+            writer.put<u8>(static_cast<u8>(PageEncoding::Packed));
+            writer.put<u32>(packed.size());
+            writer.bytes(packed.data(), packed.size());
+        } else {
+            writer.put<u8>(static_cast<u8>(PageEncoding::Raw));
+            writer.bytes(page->data(), page->size());
+        }
+    }
+
+    if (!writeFile(path, writer.data)) {
+        fmt::print("Couldn't write snapshot {}.\n", path);
+        return false;
+    }
+
+    return true;
+}
+
+bool loadSnapshot(const std::string &path, Snapshot &snapshot) {
+    if (!std::ifstream(path, std::ios::binary).is_open()) {
+        fmt::print("Couldn't open snapshot {}.\n", path);
+        return false;
+    }
+
+    std::vector<u8> data = loadFile(path);
+    Reader reader(data);
+
+    char header[sizeof(magic)];
+    if (!reader.bytes(header, sizeof(header)) || std::memcmp(header, magic, sizeof(magic)) != 0) {
+        fmt::print("{} is not a snapshot.\n", path);
+        return false;
+    }
+
+    u32 fileVersion = reader.get<u32>();
+    if (fileVersion != version) {
+        fmt::print("Snapshot {} is version {}, expected {}.\n", path, fileVersion, version);
+        return false;
+    }
+
+    reader.get<u32>(); // flags, pages say how they are encoded
+
+    Snapshot result;
+
+    for (i64 &value : result.registers.regs)
+        value = reader.get<u64>();
+
+    result.registers.hi = reader.get<u64>();
+    result.registers.lo = reader.get<u64>();
+    result.registers.pc = reader.get<u64>();
+    result.registers.llb = reader.get<u64>();
+
+    result.slot.pending = reader.get<u8>() != 0;
+    result.slot.target = reader.get<u64>();
+
+    for (u32 &value : result.cop0.regs)
+        value = reader.get<u32>();
+
+    result.cop0.countStart = reader.get<u64>();
+    result.cycles = reader.get<u64>();
+    result.idle.loops = reader.get<u64>();
+    result.idle.skips = reader.get<u64>();
+    result.idle.cycles = reader.get<u64>();
+
+    result.rsp.active = reader.get<u8>() != 0;
+    result.rsp.start = reader.get<u64>();
+
+    result.memory.registers.resize(reader.get<u32>());
+    reader.bytes(result.memory.registers.data(), result.memory.registers.size());
+
+    u32 count = reader.get<u32>();
+
+    if (reader.failed || result.memory.registers.size() != Memory::registerBytes() || count != Memory::statePages()) {
+        fmt::print("Snapshot {} doesn't match this machine.\n", path);
+        return false;
+    }
+
+    // zero pages all share one copy
+    auto zero = std::make_shared<PageData>();
+    zero->fill(0);
+
+    std::vector<u8> packed;
+
+    for (u32 a = 0; a < count; a++) {
+        auto encoding = static_cast<PageEncoding>(reader.get<u8>());
+
+        if (encoding == PageEncoding::Zero) {
+            result.memory.pages.push_back(zero);
+            continue;
+        }
+
+        auto page = std::make_shared<PageData>();
+
+        bool valid = false;
+
+        if (encoding == PageEncoding::Raw) {
+            valid = reader.bytes(page->data(), page->size());
+        } else if (encoding == PageEncoding::Packed) {
+            packed.resize(reader.get<u32>());
+            valid = reader.bytes(packed.data(), packed.size())
+                && unpackBits(packed.data(), packed.size(), page->data(), page->size());
+        }
+
+        if (!valid) {
+            fmt::print("Snapshot {} is truncated or corrupt.\n", path);
+            return false;
+        }
+
+        result.memory.pages.push_back(std::move(page));
+    }
+
+    snapshot = std::move(result);
+
+    return true;
+}
@@ -0,0 +1,65 @@
+#include <cpu/trace.h>
+
+#include <cstdio>
+
+TraceClass classify(u32 instruction) {
+    u32 op = shift(instruction, 26, 6);
+
+    switch (op) {
+        case 0b000000: {
+            u32 func = shift(instruction, 0, 6);
+            return func == 0b001000 || func == 0b001001 ? TraceClass::Flow : TraceClass::Alu;
+        }
+        case 0b010000: return TraceClass::Cop0;
+        case 0b101111: return TraceClass::Flow; // cache
+        default: break;
+    }
+
+    if (op >= 0b001000 && op <= 0b001111)
+        return TraceClass::Immediate;
+    if (op >= 0b100000)
+        return TraceClass::Data;
+
+    return TraceClass::Flow;
+}
+
+bool parseTraceClass(const std::string &name, TraceClass &out) {
+    if (name == "alu") out = TraceClass::Alu;
+    else if (name == "immediate") out = TraceClass::Immediate;
+    else if (name == "flow") out = TraceClass::Flow;
+    else if (name == "data") out = TraceClass::Data;
+    else if (name == "cop0") out = TraceClass::Cop0;
+    else return false;
+
+    return true;
+}
+
+bool Trace::enabled(u64 pc, u32 instruction) const {
+    if (!settings.enabled)
+        return false;
+
+    if (!(settings.classes & (1u << static_cast<u8>(classify(instruction)))))
+        return false;
+
+    if (settings.ranges.empty())
+        return true;
+
+    for (const TraceRange &range : settings.ranges) {
+        if (pc >= range.start && pc < range.end)
+            return true;
+    }
+
+    return false;
+}
+
+void Trace::flush() {
+    std::fwrite(buffer.data(), 1, buffer.size(), stdout);
+    buffer.clear();
+}
+
+Trace::Trace(TraceSettings settings) : settings(std::move(settings)) { }
+
+Trace::~Trace() {
+    flush();
+    std::fflush(stdout);
+}
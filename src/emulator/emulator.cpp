@@ -1,9 +1,105 @@
 #include <emulator/emulator.h>
 
-void Emulator::exec() {
-    Cpu cpu(rom);
+#include <cpu/snapshot.h>
+
+#include <fmt/printf.h>
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+static Cpu *interrupted = nullptr;
+
+static void stop(int) {
+    if (interrupted)
+        interrupted->execute = false;
+}
+
+// ctrl-c stops the cpu so stats and buffered output make it out
+static void run(Cpu &cpu) {
+    interrupted = &cpu;
+    auto previous = std::signal(SIGINT, stop);
 
     cpu.exec();
+
+    std::signal(SIGINT, previous);
+    interrupted = nullptr;
+}
+
+void Emulator::exec() {
+    Cpu cpu(rom, settings);
+
+    if (!settings.snapshot.load.empty()) {
+        Snapshot snapshot;
+        if (!loadSnapshot(settings.snapshot.load, snapshot))
+            return;
+
+        cpu.restore(snapshot);
+    }
+
+    run(cpu);
+
+    if (settings.rewind.steps) {
+        auto start = std::chrono::steady_clock::now();
+        bool rewound = cpu.rewind(settings.rewind.steps);
+        auto end = std::chrono::steady_clock::now();
+
+        if (rewound)
+            fmt::print("Rewound to cycle {} in {:.3f} ms.\n", cpu.elapsed(), std::chrono::duration<f64, std::milli>(end - start).count());
+        else
+            fmt::print("Nothing to rewind to.\n");
+    }
+
+    cpu.report();
+
+    if (!settings.snapshot.save.empty() && saveSnapshot(cpu.snapshot(), settings.snapshot.save, settings.snapshot.compress))
+        fmt::print("Saved snapshot to {}.\n", settings.snapshot.save);
+}
+
+Silence::Silence() {
+    std::fflush(stdout);
+    console = dup(STDOUT_FILENO);
+
+    int silent = open("/dev/null", O_WRONLY);
+
+    if (silent >= 0) {
+        dup2(silent, STDOUT_FILENO);
+        close(silent);
+    }
+}
+
+Silence::~Silence() {
+    std::fflush(stdout);
+
+    if (console >= 0) {
+        dup2(console, STDOUT_FILENO);
+        close(console);
+    }
+}
+
+BenchResult Emulator::bench() {
+    Cpu cpu(rom, settings);
+
+    std::chrono::steady_clock::time_point start, end;
+
+    {
+        Silence silence;
+
+        start = std::chrono::steady_clock::now();
+        run(cpu);
+        end = std::chrono::steady_clock::now();
+    }
+
+    BenchResult result;
+    result.instructions = cpu.executed();
+    result.cycles = cpu.elapsed();
+    result.seconds = std::chrono::duration<f64>(end - start).count();
+
+    return result;
 }
 
-Emulator::Emulator(const std::vector<uint8_t> &data) : rom(data) { }
\ No newline at end of file
+Emulator::Emulator(Rom rom, CpuSettings settings)
+    : rom(std::move(rom)), settings(std::move(settings)) { }
@@ -5,11 +5,35 @@
 #include <rom/rom.h>
 #include <cpu/cpu.h>
 
+class BenchResult {
+public:
+    u64 instructions = 0;
+    u64 cycles = 0;
+    f64 seconds = 0;
+};
+
+// Points stdout at /dev/null while alive, so unimplemented instruction and access warnings from
+// headless runs neither flood the console nor end up being measured.
+class Silence {
+    int console = -1;
+
+public:
+    Silence();
+    ~Silence();
+
+    Silence(const Silence &) = delete;
+    Silence &operator=(const Silence &) = delete;
+};
+
 class Emulator {
     Rom rom;
+    CpuSettings settings;
 
 public:
     void exec();
 
-    explicit Emulator(const std::vector<uint8_t> &data);
-};
\ No newline at end of file
+    // Runs with stdout silenced until the settings' limits are reached, nothing is reported.
+    BenchResult bench();
+
+    Emulator(Rom rom, CpuSettings settings);
+};
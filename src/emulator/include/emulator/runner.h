@@ -0,0 +1,85 @@
+#pragma once
+
+#include <util/util.h>
+
+#include <rom/rom.h>
+#include <cpu/cpu.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+class RunnerSettings {
+public:
+    u32 threads = 0; // zero for one per host thread
+
+    // guest cycles an instance runs before its worker looks at the queues again, one NTSC frame
+    u64 slice = 1562500;
+};
+
+class InstanceResult {
+public:
+    std::string name;
+
+    u64 instructions = 0;
+    u64 cycles = 0;
+    f64 seconds = 0; // host time spent running it, not counting waits in the queue
+
+    bool timedOut = false;
+};
+
+// Many independent machines in one process, time sliced over a pool of worker threads.
+// Instances of the same image share one Rom, and so its mapped pages. Each builds its own Cpu, with its
+// RDRAM and caches, on the worker that first runs it.
+class Runner {
+    class Instance {
+    public:
+        InstanceResult result;
+
+        std::shared_ptr<const Rom> rom;
+        CpuSettings settings;
+        f64 seconds = 0;
+
+        std::unique_ptr<Cpu> cpu;
+    };
+
+    // Worker's own instances, taken from the front by it and from the back by idle workers.
+    class Queue {
+        std::mutex lock;
+        std::deque<u32> instances;
+
+    public:
+        void push(u32 instance);
+        bool pop(u32 &instance);
+        bool steal(u32 &instance);
+    };
+
+    RunnerSettings settings;
+
+    std::vector<Instance> instances;
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::atomic<u32> remaining;
+
+    // workers with nothing to take sleep here until an instance is queued again or the last one is done
+    std::mutex idleLock;
+    std::condition_variable idle;
+    u64 requeued = 0;
+
+    void requeue(Queue &queue, u32 instance);
+    void work(u32 worker);
+    // false once the instance is done
+    bool advance(Instance &instance);
+
+public:
+    u32 threads() const;
+
+    // Queues a machine running rom until the settings' limits or seconds of host time, zero for no bound.
+    void add(const std::string &name, std::shared_ptr<const Rom> rom, const CpuSettings &settings, f64 seconds);
+
+    // Runs every instance to completion, results are in the order they were added.
+    std::vector<InstanceResult> run();
+
+    explicit Runner(const RunnerSettings &settings);
+};
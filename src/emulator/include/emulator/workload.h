@@ -0,0 +1,17 @@
+#pragma once
+
+#include <util/util.h>
+
+// Synthetic programs for --bench, each loops forever so the run length is set by the caller.
+enum class Workload : u8 {
+    Alu,
+    Memory,
+    Branch,
+    Mirror,
+};
+
+const char *getWorkloadName(Workload workload);
+bool parseWorkload(const std::string &name, Workload &out);
+
+// Builds a cartridge image with the program in the bootstrap area, where the cpu starts after PIF.
+std::vector<u8> buildWorkload(Workload workload);
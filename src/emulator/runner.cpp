@@ -0,0 +1,150 @@
+#include <emulator/runner.h>
+
+#include <chrono>
+#include <thread>
+
+void Runner::Queue::push(u32 instance) {
+    std::lock_guard<std::mutex> guard(lock);
+    instances.push_back(instance);
+}
+
+bool Runner::Queue::pop(u32 &instance) {
+    std::lock_guard<std::mutex> guard(lock);
+
+    if (instances.empty())
+        return false;
+
+    instance = instances.front();
+    instances.pop_front();
+
+    return true;
+}
+
+bool Runner::Queue::steal(u32 &instance) {
+    std::lock_guard<std::mutex> guard(lock);
+
+    if (instances.empty())
+        return false;
+
+    instance = instances.back();
+    instances.pop_back();
+
+    return true;
+}
+
+u32 Runner::threads() const {
+    u32 count = settings.threads ? settings.threads : std::max(1u, std::thread::hardware_concurrency());
+
+    return std::max(1u, std::min(count, static_cast<u32>(instances.size())));
+}
+
+void Runner::add(const std::string &name, std::shared_ptr<const Rom> rom, const CpuSettings &settings, f64 seconds) {
+    Instance instance;
+    instance.result.name = name;
+    instance.rom = std::move(rom);
+    instance.settings = settings;
+    instance.seconds = seconds;
+
+    instances.push_back(std::move(instance));
+}
+
+bool Runner::advance(Instance &instance) {
+    auto start = std::chrono::steady_clock::now();
+
+    if (!instance.cpu)
+        instance.cpu = std::make_unique<Cpu>(*instance.rom, instance.settings);
+
+    bool running = instance.cpu->slice(settings.slice);
+
+    instance.result.seconds += std::chrono::duration<f64>(std::chrono::steady_clock::now() - start).count();
+
+    if (running && instance.seconds > 0 && instance.result.seconds >= instance.seconds) {
+        instance.result.timedOut = true;
+        running = false;
+    }
+
+    if (!running) {
+        instance.result.instructions = instance.cpu->executed();
+        instance.result.cycles = instance.cpu->elapsed();
+
+        // nothing reads the machine again, give its memory back while the rest carry on
+        instance.cpu.reset();
+    }
+
+    return running;
+}
+
+void Runner::requeue(Queue &queue, u32 instance) {
+    queue.push(instance);
+
+    {
+        std::lock_guard<std::mutex> guard(idleLock);
+        requeued++;
+    }
+
+    idle.notify_one();
+}
+
+void Runner::work(u32 worker) {
+    Queue &own = *queues[worker];
+
+    while (remaining.load() > 0) {
+        // read before looking, so anything queued after the queues were checked wakes this worker
+        u64 seen;
+        {
+            std::lock_guard<std::mutex> guard(idleLock);
+            seen = requeued;
+        }
+
+        u32 index;
+        bool found = own.pop(index);
+
+        for (u32 a = 1; !found && a < queues.size(); a++)
+            found = queues[(worker + a) % queues.size()]->steal(index);
+
+        // everything left is being run by someone else
+        if (!found) {
+            std::unique_lock<std::mutex> guard(idleLock);
+            idle.wait(guard, [this, seen]() { return remaining.load() == 0 || requeued != seen; });
+            continue;
+        }
+
+        if (advance(instances[index])) {
+            requeue(own, index);
+        } else if (--remaining == 0) {
+            std::lock_guard<std::mutex> guard(idleLock);
+            idle.notify_all();
+        }
+    }
+}
+
+std::vector<InstanceResult> Runner::run() {
+    u32 count = threads();
+
+    queues.clear();
+    for (u32 a = 0; a < count; a++)
+        queues.push_back(std::make_unique<Queue>());
+
+    // dealt out round robin, stealing evens out instances that finish early
+    for (u32 a = 0; a < instances.size(); a++)
+        queues[a % count]->push(a);
+
+    remaining = static_cast<u32>(instances.size());
+
+    std::vector<std::thread> workers;
+    for (u32 a = 1; a < count; a++)
+        workers.emplace_back(&Runner::work, this, a);
+
+    work(0);
+
+    for (std::thread &worker : workers)
+        worker.join();
+
+    std::vector<InstanceResult> results;
+    for (const Instance &instance : instances)
+        results.push_back(instance.result);
+
+    return results;
+}
+
+Runner::Runner(const RunnerSettings &settings) : settings(settings), remaining(0) { }
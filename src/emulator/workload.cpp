@@ -0,0 +1,195 @@
+#include <emulator/workload.h>
+
+// Bootstrap code is copied into SP memory with the header and entered at 0xA4000040.
+static constexpr u32 entry = 0xA4000040;
+static constexpr u32 bootstrapOffset = 0x40;
+static constexpr ssi imageSize = 0x1000;
+
+enum : u8 {
+    zero = 0,
+    v0 = 2,
+    a0 = 4,
+    a1 = 5,
+    t0 = 8,
+    t1 = 9,
+    t2 = 10,
+    t3 = 11,
+    t4 = 12,
+};
+
+// Just enough of an assembler to lay out the workloads, branches take the index of their target.
+class Assembler {
+    std::vector<u32> words;
+
+    void immediate(u32 op, u8 rs, u8 rt, u16 value) {
+        words.push_back(op << 26 | rs << 21 | rt << 16 | value);
+    }
+
+    void special(u32 func, u8 rs, u8 rt, u8 rd, u8 sa = 0) {
+        words.push_back(rs << 21 | rt << 16 | rd << 11 | sa << 6 | func);
+    }
+
+    u16 offset(u32 target) const {
+        return static_cast<u16>(static_cast<i32>(target) - static_cast<i32>(words.size()) - 1);
+    }
+
+public:
+    u32 here() const { return words.size(); }
+
+    void nop() { words.push_back(0); }
+
+    void addu(u8 rd, u8 rs, u8 rt) { special(0b100001, rs, rt, rd); }
+    void subu(u8 rd, u8 rs, u8 rt) { special(0b100011, rs, rt, rd); }
+    void orr(u8 rd, u8 rs, u8 rt) { special(0b100101, rs, rt, rd); }
+    void xorr(u8 rd, u8 rs, u8 rt) { special(0b100110, rs, rt, rd); }
+    void slt(u8 rd, u8 rs, u8 rt) { special(0b101010, rs, rt, rd); }
+    void sll(u8 rd, u8 rt, u8 sa) { special(0b000000, 0, rt, rd, sa); }
+    void srl(u8 rd, u8 rt, u8 sa) { special(0b000010, 0, rt, rd, sa); }
+
+    void addiu(u8 rt, u8 rs, i16 value) { immediate(0b001001, rs, rt, static_cast<u16>(value)); }
+    void andi(u8 rt, u8 rs, u16 value) { immediate(0b001100, rs, rt, value); }
+    void lui(u8 rt, u16 value) { immediate(0b001111, 0, rt, value); }
+
+    void lw(u8 rt, u8 base, i16 value) { immediate(0b100011, base, rt, static_cast<u16>(value)); }
+    void sw(u8 rt, u8 base, i16 value) { immediate(0b101011, base, rt, static_cast<u16>(value)); }
+
+    void beq(u8 rs, u8 rt, u32 target) { immediate(0b000100, rs, rt, offset(target)); }
+    void bne(u8 rs, u8 rt, u32 target) { immediate(0b000101, rs, rt, offset(target)); }
+    void bgtz(u8 rs, u32 target) { immediate(0b000111, rs, 0, offset(target)); }
+
+    void j(u32 target) {
+        words.push_back(0b000010u << 26 | (((entry + target * sizeof(u32)) >> 2) & 0x03FFFFFF));
+    }
+
+    const std::vector<u32> &code() const { return words; }
+};
+
+// Register-only arithmetic, one taken branch every nine instructions.
+static void assembleAlu(Assembler &assembler) {
+    u32 start = assembler.here();
+    assembler.lui(t0, 0x0001);
+
+    u32 loop = assembler.here();
+    assembler.addu(t1, t1, t0);
+    assembler.xorr(t2, t2, t1);
+    assembler.sll(t3, t2, 3);
+    assembler.srl(t4, t3, 1);
+    assembler.slt(v0, t4, t1);
+    assembler.orr(t2, t2, v0);
+    assembler.addiu(t0, t0, -1);
+    assembler.bne(t0, zero, loop);
+    assembler.subu(t1, t1, t2);
+
+    assembler.j(start);
+    assembler.nop();
+}
+
+// Read-modify-write over 64 KiB of RDRAM through KSEG0, a word at a time.
+static void assembleStream(Assembler &assembler) {
+    u32 start = assembler.here();
+    assembler.lui(a0, 0x8010);
+    assembler.addiu(t0, zero, 0x4000);
+
+    u32 loop = assembler.here();
+    assembler.lw(t1, a0, 0);
+    assembler.addu(t1, t1, t0);
+    assembler.sw(t1, a0, 0);
+    assembler.lw(t2, a0, 4);
+    assembler.xorr(t2, t2, t1);
+    assembler.addiu(t0, t0, -1);
+    assembler.bne(t0, zero, loop);
+    assembler.addiu(a0, a0, 4);
+
+    assembler.j(start);
+    assembler.nop();
+}
+
+// The same stream, loading through uncached KSEG1 and storing through cached KSEG0 of the same RDRAM.
+static void assembleMirror(Assembler &assembler) {
+    u32 start = assembler.here();
+    assembler.lui(a0, 0xA010);
+    assembler.lui(a1, 0x8010);
+    assembler.addiu(t0, zero, 0x4000);
+
+    u32 loop = assembler.here();
+    assembler.lw(t1, a0, 0);
+    assembler.addu(t1, t1, t0);
+    assembler.sw(t1, a1, 0);
+    assembler.addiu(a0, a0, 4);
+    assembler.addiu(t0, t0, -1);
+    assembler.bne(t0, zero, loop);
+    assembler.addiu(a1, a1, 4);
+
+    assembler.j(start);
+    assembler.nop();
+}
+
+// Short blocks, two conditional branches per pass taken in alternating patterns.
+static void assembleBranch(Assembler &assembler) {
+    u32 start = assembler.here();
+    assembler.addiu(t0, zero, 0x4000);
+
+    u32 loop = assembler.here();
+    assembler.andi(t1, t0, 1);
+    assembler.beq(t1, zero, assembler.here() + 3); // past the increment
+    assembler.nop();
+    assembler.addiu(t2, t2, 1);
+
+    assembler.andi(t1, t0, 2);
+    assembler.bne(t1, zero, assembler.here() + 3);
+    assembler.nop();
+    assembler.addiu(t3, t3, 1);
+
+    assembler.addiu(t0, t0, -1);
+    assembler.bgtz(t0, loop);
+    assembler.nop();
+
+    assembler.j(start);
+    assembler.nop();
+}
+
+const char *getWorkloadName(Workload workload) {
+    switch (workload) {
+        case Workload::Alu: return "alu";
+        case Workload::Memory: return "memory";
+        case Workload::Branch: return "branch";
+        case Workload::Mirror: return "mirror";
+    }
+
+    return "";
+}
+
+bool parseWorkload(const std::string &name, Workload &out) {
+    for (Workload workload : { Workload::Alu, Workload::Memory, Workload::Branch, Workload::Mirror }) {
+        if (name == getWorkloadName(workload)) {
+            out = workload;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+std::vector<u8> buildWorkload(Workload workload) {
+    Assembler assembler;
+
+    switch (workload) {
+        case Workload::Alu: assembleAlu(assembler); break;
+        case Workload::Memory: assembleStream(assembler); break;
+        case Workload::Branch: assembleBranch(assembler); break;
+        case Workload::Mirror: assembleMirror(assembler); break;
+    }
+
+    std::vector<u8> image(imageSize);
+
+    const std::vector<u32> &code = assembler.code();
+    assert(bootstrapOffset + code.size() * sizeof(u32) <= image.size());
+
+    // cartridges are big endian
+    for (ssi a = 0; a < code.size(); a++) {
+        u32 word = swap(code[a]);
+        std::memcpy(&image[bootstrapOffset + a * sizeof(u32)], &word, sizeof(u32));
+    }
+
+    return image;
+}
@@ -0,0 +1,251 @@
+#include <interface/interface.h>
+
+#include <rom/rom.h>
+#include <rom/checksum.h>
+
+#include <fmt/printf.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <thread>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+enum class BatchStatus : u8 {
+    Converted,
+    Normalized, // already z64, nothing to write
+    Verified, // checked only, no output directory
+    Invalid,
+    Failed,
+};
+
+class BatchResult {
+public:
+    BatchStatus status = BatchStatus::Failed;
+    ByteOrder order = ByteOrder::Unknown;
+    u64 bytes = 0;
+
+    std::string message;
+};
+
+static bool isDirectory(const std::string &path) {
+    struct stat info = {};
+    return stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+static bool isFile(const std::string &path) {
+    struct stat info = {};
+    return stat(path.c_str(), &info) == 0 && S_ISREG(info.st_mode);
+}
+
+static std::string baseName(const std::string &path) {
+    ssi slash = path.find_last_of('/');
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+// where a converted image goes, named after the input with its extension swapped for .z64
+static std::string targetPath(const std::string &path, const std::string &directory) {
+    std::string name = baseName(path);
+    return directory + "/" + name.substr(0, name.find_last_of('.')) + ".z64";
+}
+
+// two inputs converting to the same file would have workers truncating it under each other
+static bool uniqueTargets(const std::vector<std::string> &paths, const std::string &directory) {
+    std::map<std::string, const std::string *> targets;
+    bool unique = true;
+
+    for (const std::string &path : paths) {
+        auto inserted = targets.emplace(targetPath(path, directory), &path);
+
+        if (!inserted.second) {
+            fmt::print("{} and {} would both be written to {}.\n", *inserted.first->second, path, inserted.first->first);
+            unique = false;
+        }
+    }
+
+    return unique;
+}
+
+// manifests have one path per line, relative to where the manifest lives
+bool Interface::listInputs(const std::string &input, std::vector<std::string> &out) {
+    if (isDirectory(input)) {
+        DIR *directory = opendir(input.c_str());
+        if (!directory)
+            return false;
+
+        while (dirent *entry = readdir(directory)) {
+            std::string path = input + "/" + entry->d_name;
+
+            if (entry->d_name[0] != '.' && isFile(path))
+                out.push_back(path);
+        }
+
+        closedir(directory);
+
+        std::sort(out.begin(), out.end());
+        return true;
+    }
+
+    std::ifstream manifest(input);
+    if (!manifest.is_open())
+        return false;
+
+    ssi slash = input.find_last_of('/');
+    std::string base = slash == std::string::npos ? "" : input.substr(0, slash + 1);
+
+    std::string line;
+    while (std::getline(manifest, line)) {
+        line.erase(line.find_last_not_of(" \t\r") + 1);
+
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        out.push_back(line[0] == '/' ? line : base + line);
+    }
+
+    return true;
+}
+
+// the checksum only covers the start of the image, so only that much is converted
+static bool checkImage(const MappedFile &file, ByteOrder order, std::vector<u8> &scratch, std::string &message) {
+    scratch.resize(std::min<ssi>(file.size(), mb(1) + kb(4)));
+    toBigEndian(order, file.data(), scratch.data(), scratch.size());
+
+    ChecksumResult result = verifyChecksum(scratch.data(), scratch.size());
+
+    if (result.valid)
+        return true;
+
+    if (result.cic == Cic::Unknown)
+        message = "unknown CIC";
+    else
+        message = fmt::format("checksum {:016X} doesn't match {:016X} in the header", result.actual, result.expected);
+
+    return false;
+}
+
+static BatchResult process(const std::string &path, const std::string &directory, bool checksum, std::vector<u8> &scratch) {
+    BatchResult result;
+
+    MappedFile file(path);
+
+    if (file.empty()) {
+        result.status = BatchStatus::Invalid;
+        result.message = "empty or unreadable";
+        return result;
+    }
+
+    result.bytes = file.size();
+    result.order = detectByteOrder(file.data(), file.size());
+
+    if (result.order == ByteOrder::Unknown) {
+        result.status = BatchStatus::Invalid;
+        result.message = "unrecognized byte order";
+        return result;
+    }
+
+    if (file.size() < sizeof(Header) || file.size() % sizeof(u32)) {
+        result.status = BatchStatus::Invalid;
+        result.message = fmt::format("truncated at {} bytes", file.size());
+        return result;
+    }
+
+    if (checksum && !checkImage(file, result.order, scratch, result.message)) {
+        result.status = BatchStatus::Invalid;
+        return result;
+    }
+
+    if (directory.empty()) {
+        result.status = BatchStatus::Verified;
+        return result;
+    }
+
+    if (result.order == ByteOrder::Big) {
+        result.status = BatchStatus::Normalized;
+        return result;
+    }
+
+    std::string target = targetPath(path, directory);
+
+    if (!writeBigEndian(result.order, file, target)) {
+        result.status = BatchStatus::Failed;
+        result.message = fmt::format("couldn't write {}", target);
+        return result;
+    }
+
+    result.status = BatchStatus::Converted;
+    return result;
+}
+
+int Interface::batch() {
+    std::vector<std::string> paths;
+
+    if (!listInputs(input, paths)) {
+        fmt::print("Couldn't read {}.\n", input);
+        return -1;
+    }
+
+    if (!output.empty() && !isDirectory(output)) {
+        fmt::print("Output {} is not a directory.\n", output);
+        return -1;
+    }
+
+    if (!output.empty() && !uniqueTargets(paths, output)) {
+        fmt::print("Rename the inputs so each converts to its own file.\n");
+        return -1;
+    }
+
+    u32 threads = jobs ? jobs : std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<u32>(std::min<ssi>(threads, std::max<ssi>(paths.size(), 1)));
+
+    std::vector<BatchResult> results(paths.size());
+    std::atomic<ssi> next(0);
+
+    // each worker holds one image mapping, one conversion chunk and the checksummed area at a time
+    auto work = [&]() {
+        std::vector<u8> scratch;
+
+        for (ssi a = next++; a < paths.size(); a = next++)
+            results[a] = process(paths[a], output, checksum, scratch);
+    };
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+    for (u32 a = 1; a < threads; a++)
+        workers.emplace_back(work);
+
+    work();
+
+    for (std::thread &worker : workers)
+        worker.join();
+
+    f64 seconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - start).count();
+
+    u64 counts[5] = {};
+    u64 bytes = 0;
+
+    for (ssi a = 0; a < paths.size(); a++) {
+        const BatchResult &result = results[a];
+
+        counts[static_cast<u8>(result.status)]++;
+        bytes += result.bytes;
+
+        if (!result.message.empty())
+            fmt::print("{}: {}\n", paths[a], result.message);
+    }
+
+    f64 mib = bytes / f64(mb(1));
+
+    fmt::print("Batch: {} files, {} converted, {} already z64, {} verified, {} invalid, {} failed.\n",
+        paths.size(), counts[static_cast<u8>(BatchStatus::Converted)], counts[static_cast<u8>(BatchStatus::Normalized)],
+        counts[static_cast<u8>(BatchStatus::Verified)], counts[static_cast<u8>(BatchStatus::Invalid)],
+        counts[static_cast<u8>(BatchStatus::Failed)]);
+    fmt::print("{:.1f} MiB in {:.3f}s on {} threads, {:.1f} MiB/s.\n", mib, seconds, threads, seconds > 0 ? mib / seconds : 0.0);
+
+    return counts[static_cast<u8>(BatchStatus::Invalid)] || counts[static_cast<u8>(BatchStatus::Failed)] ? -1 : 0;
+}
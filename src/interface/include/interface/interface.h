@@ -2,6 +2,9 @@
 
 #include <util/util.h>
 
+#include <cpu/settings.h>
+#include <emulator/workload.h>
+
 class Interface {
     std::string input;
     std::string output;
@@ -9,9 +12,36 @@ class Interface {
     enum class Mode {
         Launch,
         Convert,
+        Bench,
+        Batch,
+        Multi,
     };
 
     Mode mode = Mode::Launch;
+
+    // read the whole ROM in up front rather than as pages are first touched
+    bool preload = false;
+    // verify the header checksum when loading, Batch rejects images that fail it
+    bool checksum = false;
+
+    CpuSettings settings;
+
+    // built-in programs for Bench, every one of them when empty and no ROM is given
+    std::vector<Workload> workloads;
+
+    // Batch converts every image listed in input into output, or only checks them without an output.
+    u32 jobs = 0; // worker threads, zero for one per host thread
+
+    // Multi runs copies instances of every image listed in input, each for at most seconds of host time.
+    u32 copies = 1;
+    f64 seconds = 0;
+
+    // every regular file in a directory, or the paths listed in a manifest
+    static bool listInputs(const std::string &input, std::vector<std::string> &out);
+
+    int bench();
+    int batch();
+    int multi();
 public:
     int exec();
 
@@ -1,37 +1,273 @@
 #include <interface/interface.h>
 
 #include <emulator/emulator.h>
+#include <emulator/runner.h>
+#include <rom/checksum.h>
 
 #include <fmt/printf.h>
 
+#include <chrono>
+
+#include <sys/resource.h>
+
+static void reportBench(const std::string &name, const BenchResult &result) {
+    f64 rate = result.seconds > 0 ? result.instructions / result.seconds : 0;
+    f64 cost = result.instructions ? result.seconds * 1e9 / result.instructions : 0;
+
+    fmt::print("{:<16} {:>12} instructions {:>12} cycles {:>8.3f}s {:>9.2f} M instr/s {:>7.2f} ns/instr\n",
+        name, result.instructions, result.cycles, result.seconds, rate / 1e6, cost);
+}
+
+// a bad checksum is only a warning, homebrew and patched images often carry a stale one
+static void reportChecksum(const ChecksumResult &result) {
+    if (result.cic == Cic::Unknown)
+        fmt::print("Checksum: unknown CIC, not checked.\n");
+    else if (result.valid)
+        fmt::print("Checksum: {:016X} matches, CIC {}.\n", result.actual, getCicName(result.cic));
+    else
+        fmt::print("Checksum: header has {:016X}, image is {:016X}, CIC {}.\n",
+            result.expected, result.actual, getCicName(result.cic));
+}
+
+int Interface::bench() {
+    // without a bound the run never ends
+    if (!settings.limits.instructions && !settings.limits.cycles)
+        settings.limits.instructions = 100000000;
+
+    if (!input.empty()) {
+        MappedFile file(input);
+
+        if (file.empty()) {
+            fmt::print("Invalid input file.\n");
+            return -1;
+        }
+
+        if (preload)
+            file.prefetch();
+
+        reportBench(input, Emulator(Rom(std::move(file)), settings).bench());
+    } else {
+        if (workloads.empty())
+            workloads = { Workload::Alu, Workload::Memory, Workload::Branch, Workload::Mirror };
+
+        for (Workload workload : workloads)
+            reportBench(getWorkloadName(workload), Emulator(Rom(buildWorkload(workload)), settings).bench());
+    }
+
+    rusage usage = {};
+    getrusage(RUSAGE_SELF, &usage);
+
+    // ru_maxrss is in KiB on Linux
+    fmt::print("Peak RSS: {:.1f} MiB\n", usage.ru_maxrss / 1024.0);
+
+    return 0;
+}
+
 int Interface::exec() {
+    // instances share the process, one sampling timer and one log, and nothing collects a report per instance
+    if (mode == Mode::Multi && (settings.profile.enabled || settings.trace.enabled)) {
+        fmt::print("--profile and tracing aren't supported with --multi, ignoring them.\n");
+        settings.profile.enabled = false;
+        settings.trace.enabled = false;
+    }
+
+#ifndef SCOUT_TRACE
+    if (settings.trace.enabled)
+        fmt::print("Tracing is not compiled in, configure with -DSCOUT_TRACE=ON.\n");
+#endif
+
+    if (settings.engine == CpuEngine::Recompiler) {
+        if (!Recompiler::supported())
+            fmt::print("The recompiler does not support this host, falling back to the interpreter.\n");
+        else if (settings.trace.enabled)
+            fmt::print("Tracing runs on the interpreter, ignoring --jit.\n");
+    }
+
+    if (mode == Mode::Bench)
+        return bench();
+
+    if (mode == Mode::Batch)
+        return batch();
+
+    if (mode == Mode::Multi)
+        return multi();
+
     if (input.empty()) {
         fmt::print("Missing input file.\n");
         return -1;
     }
 
-    std::vector<uint8_t> data = loadFile(input);
+    MappedFile file(input);
 
-    if (data.empty()) {
+    if (file.empty()) {
         fmt::print("Invalid input file.\n");
         return -1;
     }
 
+    if (preload)
+        file.prefetch();
+
     switch (mode) {
         case Mode::Launch: {
-            Emulator(data).exec();
+            Rom rom(std::move(file));
+
+            if (checksum)
+                reportChecksum(verifyChecksum(rom.data(), rom.size()));
+
+            Emulator(std::move(rom), settings).exec();
             break;
         }
         case Mode::Convert: {
-            std::vector<u8> flipped = Rom::flipEndian<u16>(data);
-            writeFile(output, flipped);
+            ByteOrder order = detectByteOrder(file.data(), file.size());
+
+            if (order == ByteOrder::Unknown) {
+                fmt::print("Unrecognized byte order in {}.\n", input);
+                return -1;
+            }
+
+            if (!writeBigEndian(order, file, output)) {
+                fmt::print("Couldn't write {}.\n", output);
+                return -1;
+            }
+
+            fmt::print("Converted {} from {} to z64.\n", input, getByteOrderName(order));
+            break;
+        }
+        default:
             break;
+    }
+
+    return 0;
+}
+
+int Interface::multi() {
+    std::vector<std::string> paths;
+
+    if (!listInputs(input, paths) || paths.empty()) {
+        fmt::print("No images found in {}.\n", input);
+        return -1;
+    }
+
+    // without a bound the run never ends
+    if (!settings.limits.instructions && !settings.limits.cycles && seconds <= 0)
+        settings.limits.instructions = 100000000;
+
+    RunnerSettings runnerSettings;
+    runnerSettings.threads = jobs;
+
+    Runner runner(runnerSettings);
+    u32 images = 0;
+
+    for (const std::string &path : paths) {
+        MappedFile file(path);
+
+        if (file.empty()) {
+            fmt::print("{}: empty or unreadable, skipped.\n", path);
+            continue;
         }
+
+        // one Rom per image, every copy runs from the same pages
+        auto rom = std::make_shared<const Rom>(std::move(file));
+        images++;
+
+        for (u32 a = 0; a < copies; a++)
+            runner.add(copies > 1 ? fmt::format("{}#{}", path, a) : path, rom, settings, seconds);
     }
 
+    u32 threads = runner.threads();
+
+    std::vector<InstanceResult> results;
+    auto start = std::chrono::steady_clock::now();
+
+    {
+        Silence silence;
+        results = runner.run();
+    }
+
+    f64 wall = std::chrono::duration<f64>(std::chrono::steady_clock::now() - start).count();
+
+    u64 instructions = 0;
+
+    for (const InstanceResult &result : results) {
+        instructions += result.instructions;
+
+        BenchResult bench;
+        bench.instructions = result.instructions;
+        bench.cycles = result.cycles;
+        bench.seconds = result.seconds;
+
+        reportBench(result.name, bench);
+
+        if (result.timedOut)
+            fmt::print("{}: stopped at the {:.1f}s time limit.\n", result.name, seconds);
+    }
+
+    rusage usage = {};
+    getrusage(RUSAGE_SELF, &usage);
+
+    fmt::print("{} instances of {} images on {} threads: {} instructions in {:.3f}s, {:.2f} M instr/s.\n",
+        results.size(), images, threads, instructions, wall, wall > 0 ? instructions / wall / 1e6 : 0.0);
+    fmt::print("Peak RSS: {:.1f} MiB\n", usage.ru_maxrss / 1024.0);
+
     return 0;
 }
 
+static bool parseTraceRange(const std::string &text, TraceRange &out) {
+    ssi split = text.find('-');
+
+    if (split == std::string::npos)
+        return false;
+
+    try {
+        out.start = std::stoul(text.substr(0, split), nullptr, 0);
+        out.end = std::stoul(text.substr(split + 1), nullptr, 0);
+    } catch (const std::exception &) {
+        return false;
+    }
+
+    return out.start < out.end;
+}
+
+static bool parseAddress(const std::string &text, u32 &out) {
+    try {
+        out = std::stoul(text, nullptr, 0);
+    } catch (const std::exception &) {
+        return false;
+    }
+
+    return true;
+}
+
+static bool parseCount(const std::string &text, u64 &out) {
+    try {
+        out = std::stoull(text, nullptr, 0);
+    } catch (const std::exception &) {
+        return false;
+    }
+
+    return out != 0;
+}
+
+static bool parseTraceClasses(const std::string &text, u32 &out) {
+    out = 0;
+
+    ssi start = 0;
+    while (start <= text.size()) {
+        ssi end = text.find(',', start);
+        if (end == std::string::npos)
+            end = text.size();
+
+        TraceClass traceClass;
+        if (!parseTraceClass(text.substr(start, end - start), traceClass))
+            return false;
+
+        out |= 1u << static_cast<u8>(traceClass);
+        start = end + 1;
+    }
+
+    return true;
+}
+
 Interface::Interface(i32 count, char **args) {
     for (uint32_t a = 1; a < count; a++) {
         const char *arg = args[a];
@@ -44,6 +280,163 @@ Interface::Interface(i32 count, char **args) {
             } else {
                 fmt::print("Missing output arg for -z.");
             }
+        } else if (strcmp(arg, "--batch") == 0) {
+            if (a + 1 < count) {
+                mode = Mode::Batch;
+                input = args[a + 1];
+                a++;
+            } else {
+                fmt::print("Expected a directory or manifest after --batch.\n");
+            }
+        } else if (strcmp(arg, "--out") == 0) {
+            if (a + 1 < count) {
+                output = args[a + 1];
+                a++;
+            } else {
+                fmt::print("Expected a directory after --out.\n");
+            }
+        } else if (strcmp(arg, "--multi") == 0) {
+            if (a + 1 < count) {
+                mode = Mode::Multi;
+                input = args[a + 1];
+                a++;
+            } else {
+                fmt::print("Expected a directory or manifest after --multi.\n");
+            }
+        } else if (strcmp(arg, "--copies") == 0) {
+            u64 value;
+            if (a + 1 < count && parseCount(args[a + 1], value)) {
+                copies = static_cast<u32>(value);
+                a++;
+            } else {
+                fmt::print("Expected a count after --copies.\n");
+            }
+        } else if (strcmp(arg, "--seconds") == 0) {
+            try {
+                if (a + 1 >= count)
+                    throw std::invalid_argument("missing");
+
+                seconds = std::stod(args[a + 1]);
+                a++;
+            } catch (const std::exception &) {
+                fmt::print("Expected a time in seconds after --seconds.\n");
+            }
+        } else if (strcmp(arg, "--jobs") == 0) {
+            u64 value;
+            if (a + 1 < count && parseCount(args[a + 1], value)) {
+                jobs = static_cast<u32>(value);
+                a++;
+            } else {
+                fmt::print("Expected a thread count after --jobs.\n");
+            }
+        } else if (strcmp(arg, "--checksum") == 0) {
+            checksum = true;
+        } else if (strcmp(arg, "--preload") == 0) {
+            preload = true;
+        } else if (strcmp(arg, "--bench") == 0) {
+            mode = Mode::Bench;
+        } else if (strcmp(arg, "--workload") == 0) {
+            Workload workload;
+            if (a + 1 < count && parseWorkload(args[a + 1], workload)) {
+                workloads.push_back(workload);
+                a++;
+            } else {
+                fmt::print("Expected one of alu, memory, branch, mirror after --workload.\n");
+            }
+        } else if (strcmp(arg, "--instructions") == 0) {
+            if (a + 1 < count && parseCount(args[a + 1], settings.limits.instructions)) {
+                a++;
+            } else {
+                fmt::print("Expected a count after --instructions.\n");
+            }
+        } else if (strcmp(arg, "--cycles") == 0) {
+            if (a + 1 < count && parseCount(args[a + 1], settings.limits.cycles)) {
+                a++;
+            } else {
+                fmt::print("Expected a count after --cycles.\n");
+            }
+        } else if (strcmp(arg, "--profile") == 0) {
+            if (a + 1 < count) {
+                settings.profile.enabled = true;
+                settings.profile.output = strcmp(args[a + 1], "-") == 0 ? "" : args[a + 1];
+                a++;
+            } else {
+                fmt::print("Expected a report path, or - for stdout, after --profile.\n");
+            }
+        } else if (strcmp(arg, "--load-state") == 0) {
+            if (a + 1 < count) {
+                settings.snapshot.load = args[a + 1];
+                a++;
+            } else {
+                fmt::print("Expected a snapshot path after --load-state.\n");
+            }
+        } else if (strcmp(arg, "--save-state") == 0) {
+            if (a + 1 < count) {
+                settings.snapshot.save = args[a + 1];
+                a++;
+            } else {
+                fmt::print("Expected a snapshot path after --save-state.\n");
+            }
+        } else if (strcmp(arg, "--state-raw") == 0) {
+            settings.snapshot.compress = false;
+        } else if (strcmp(arg, "--rewind-buffer") == 0) {
+            u64 size;
+            if (a + 1 < count && parseCount(args[a + 1], size)) {
+                settings.rewind.capacity = mb(size);
+                a++;
+            } else {
+                fmt::print("Expected a size in MiB after --rewind-buffer.\n");
+            }
+        } else if (strcmp(arg, "--rewind") == 0) {
+            u64 steps;
+            if (a + 1 < count && parseCount(args[a + 1], steps)) {
+                settings.rewind.steps = static_cast<u32>(steps);
+                if (!settings.rewind.capacity)
+                    settings.rewind.capacity = mb(64);
+                a++;
+            } else {
+                fmt::print("Expected a number of points after --rewind.\n");
+            }
+        } else if (strcmp(arg, "--rsp-thread") == 0) {
+            settings.rsp.threaded = true;
+        } else if (strcmp(arg, "--rsp-slack") == 0) {
+            u64 slack;
+            if (a + 1 < count && parseCount(args[a + 1], slack)) {
+                settings.rsp.slack = slack;
+                a++;
+            } else {
+                fmt::print("Expected a number of cycles after --rsp-slack.\n");
+            }
+        } else if (strcmp(arg, "--jit") == 0) {
+            settings.engine = CpuEngine::Recompiler;
+        } else if (strcmp(arg, "--no-idle-skip") == 0) {
+            settings.idle.detect = false;
+        } else if (strcmp(arg, "--idle") == 0) {
+            u32 address;
+            if (a + 1 < count && parseAddress(args[a + 1], address)) {
+                settings.idle.addresses.push_back(address);
+                a++;
+            } else {
+                fmt::print("Expected an address after --idle.\n");
+            }
+        } else if (strcmp(arg, "--trace") == 0) {
+            settings.trace.enabled = true;
+        } else if (strcmp(arg, "--trace-range") == 0) {
+            TraceRange range;
+            if (a + 1 < count && parseTraceRange(args[a + 1], range)) {
+                settings.trace.enabled = true;
+                settings.trace.ranges.push_back(range);
+                a++;
+            } else {
+                fmt::print("Expected <start>-<end> after --trace-range.\n");
+            }
+        } else if (strcmp(arg, "--trace-class") == 0) {
+            if (a + 1 < count && parseTraceClasses(args[a + 1], settings.trace.classes)) {
+                settings.trace.enabled = true;
+                a++;
+            } else {
+                fmt::print("Expected a list of alu,immediate,flow,data,cop0 after --trace-class.\n");
+            }
         } else {
             input = arg;
         };
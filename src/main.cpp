@@ -1,5 +1,11 @@
 #include <interface/interface.h>
 
+#include <util/log.h>
+
 int main(int count, char **args) {
-    return Interface(count, args).exec();
+    int result = Interface(count, args).exec();
+
+    printLogSummary();
+
+    return result;
 }
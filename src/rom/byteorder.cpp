@@ -0,0 +1,175 @@
+#include <rom/byteorder.h>
+
+#include <algorithm>
+#include <fstream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SCOUT_X86
+#endif
+
+const char *getByteOrderName(ByteOrder order) {
+    switch (order) {
+        case ByteOrder::Big: return "z64";
+        case ByteOrder::Swapped: return "v64";
+        case ByteOrder::Little: return "n64";
+        default: return "unknown";
+    }
+}
+
+ByteOrder detectByteOrder(const u8 *data, ssi size) {
+    if (size < 4)
+        return ByteOrder::Unknown;
+
+    // PI settings word, 0x80371240 on every commercial cartridge
+    u32 magic = static_cast<u32>(data[0]) << 24 | data[1] << 16 | data[2] << 8 | data[3];
+
+    switch (magic) {
+        case 0x80371240: return ByteOrder::Big;
+        case 0x37804012: return ByteOrder::Swapped;
+        case 0x40123780: return ByteOrder::Little;
+        default: return ByteOrder::Unknown;
+    }
+}
+
+typedef void (*SwapKernel)(const u8 *input, u8 *output, ssi size);
+
+template <typename T>
+static void swapScalar(const u8 *input, u8 *output, ssi size) {
+    for (ssi a = 0; a + sizeof(T) <= size; a += sizeof(T)) {
+        T value;
+        std::memcpy(&value, input + a, sizeof(T));
+
+        value = swap(value);
+        std::memcpy(output + a, &value, sizeof(T));
+    }
+}
+
+#ifdef SCOUT_X86
+
+// part of the x86-64 baseline, the fallback when the cpu has nothing newer
+template <typename T>
+static void swapSse2(const u8 *input, u8 *output, ssi size) {
+    ssi a = 0;
+
+    for (; a + 16 <= size; a += 16) {
+        __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input + a));
+
+        // swap the halves of every word first, then the bytes of every half
+        if (sizeof(T) == 4)
+            value = _mm_shufflehi_epi16(_mm_shufflelo_epi16(value, 0xB1), 0xB1);
+
+        value = _mm_or_si128(_mm_slli_epi16(value, 8), _mm_srli_epi16(value, 8));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(output + a), value);
+    }
+
+    swapScalar<T>(input + a, output + a, size - a);
+}
+
+template <typename T>
+__attribute__((target("ssse3"))) static void swapSsse3(const u8 *input, u8 *output, ssi size) {
+    const __m128i mask = sizeof(T) == 2
+        ? _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14)
+        : _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+
+    ssi a = 0;
+
+    for (; a + 16 <= size; a += 16) {
+        __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input + a));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(output + a), _mm_shuffle_epi8(value, mask));
+    }
+
+    swapScalar<T>(input + a, output + a, size - a);
+}
+
+template <typename T>
+__attribute__((target("avx2"))) static void swapAvx2(const u8 *input, u8 *output, ssi size) {
+    // vpshufb shuffles within each 128 bit lane, so the pattern repeats
+    const __m256i mask = sizeof(T) == 2
+        ? _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+            1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14)
+        : _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+            3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+
+    ssi a = 0;
+
+    for (; a + 64 <= size; a += 64) {
+        __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(input + a));
+        __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(input + a + 32));
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(output + a), _mm256_shuffle_epi8(low, mask));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(output + a + 32), _mm256_shuffle_epi8(high, mask));
+    }
+
+    swapScalar<T>(input + a, output + a, size - a);
+}
+
+#endif
+
+template <typename T>
+static SwapKernel selectKernel() {
+#ifdef SCOUT_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2"))
+        return swapAvx2<T>;
+    if (__builtin_cpu_supports("ssse3"))
+        return swapSsse3<T>;
+
+    return swapSse2<T>;
+#else
+    return swapScalar<T>;
+#endif
+}
+
+void swapBytes(u32 width, const u8 *input, u8 *output, ssi size) {
+    static const SwapKernel swap16 = selectKernel<u16>();
+    static const SwapKernel swap32 = selectKernel<u32>();
+
+    assert(width == 2 || width == 4);
+
+    ssi whole = size - size % width;
+    (width == 2 ? swap16 : swap32)(input, output, whole);
+
+    if (input != output)
+        std::memcpy(output + whole, input + whole, size - whole);
+}
+
+void toBigEndian(ByteOrder order, const u8 *input, u8 *output, ssi size) {
+    switch (order) {
+        case ByteOrder::Swapped:
+            swapBytes(2, input, output, size);
+            break;
+        case ByteOrder::Little:
+            swapBytes(4, input, output, size);
+            break;
+        default:
+            if (input != output)
+                std::memcpy(output, input, size);
+            break;
+    }
+}
+
+bool writeBigEndian(ByteOrder order, const MappedFile &file, const std::string &path) {
+    // small enough to stay in cache between converting and writing
+    static constexpr ssi chunkSize = kb(256);
+
+    std::ofstream stream(path, std::ios::trunc | std::ios::binary);
+
+    if (!stream.is_open())
+        return false;
+
+    std::vector<u8> chunk(std::min(chunkSize, file.size()));
+
+    for (ssi offset = 0; offset < file.size(); offset += chunk.size()) {
+        ssi length = std::min(chunk.size(), file.size() - offset);
+
+        toBigEndian(order, file.data() + offset, chunk.data(), length);
+        stream.write(reinterpret_cast<const char *>(chunk.data()), length);
+
+        file.release(offset, length);
+    }
+
+    return static_cast<bool>(stream);
+}
@@ -0,0 +1,174 @@
+#include <rom/checksum.h>
+
+static constexpr u32 bootstrapStart = 0x40;
+static constexpr u32 checksumStart = 0x1000;
+static constexpr u32 checksumEnd = 0x101000;
+
+// 6105 bootstrap words mixed into the checksum
+static constexpr u32 bootstrapTable = 0x750;
+
+const char *getCicName(Cic cic) {
+    switch (cic) {
+        case Cic::Cic6101: return "6101";
+        case Cic::Cic6102: return "6102";
+        case Cic::Cic6103: return "6103";
+        case Cic::Cic6105: return "6105";
+        case Cic::Cic6106: return "6106";
+        case Cic::Cic7102: return "7102";
+        default: return "unknown";
+    }
+}
+
+class Crc32Table {
+public:
+    u32 entries[256] = {};
+};
+
+static constexpr Crc32Table makeCrc32Table() {
+    Crc32Table table;
+
+    for (u32 a = 0; a < 256; a++) {
+        u32 value = a;
+
+        for (u32 bit = 0; bit < 8; bit++)
+            value = value & 1 ? (value >> 1) ^ 0xEDB88320 : value >> 1;
+
+        table.entries[a] = value;
+    }
+
+    return table;
+}
+
+static u32 crc32(const u8 *data, ssi size) {
+    static constexpr Crc32Table table = makeCrc32Table();
+
+    u32 value = ~0u;
+
+    for (ssi a = 0; a < size; a++)
+        value = table.entries[(value ^ data[a]) & 0xFF] ^ (value >> 8);
+
+    return ~value;
+}
+
+Cic detectCic(const u8 *data, ssi size) {
+    if (size < checksumStart)
+        return Cic::Unknown;
+
+    switch (crc32(data + bootstrapStart, checksumStart - bootstrapStart)) {
+        case 0x6170A4A1: return Cic::Cic6101;
+        case 0x90BB6CB5: return Cic::Cic6102;
+        case 0x0B050EE0: return Cic::Cic6103;
+        case 0x98BC2C86: return Cic::Cic6105;
+        case 0xACC8580A: return Cic::Cic6106;
+        case 0x009E9EA3: return Cic::Cic7102;
+        default: return Cic::Unknown;
+    }
+}
+
+static u32 seed(Cic cic) {
+    switch (cic) {
+        case Cic::Cic6103: return 0xA3886759;
+        case Cic::Cic6105: return 0xDF26F436;
+        case Cic::Cic6106: return 0x1FEA617A;
+        default: return 0xF8CA4DDC;
+    }
+}
+
+static u32 word(const u8 *data) {
+    u32 value;
+    std::memcpy(&value, data, sizeof(u32));
+
+    return swap(value);
+}
+
+class ChecksumState {
+public:
+    u32 t1, t2, t3, t4, t5, t6;
+
+    explicit ChecksumState(u32 seed) : t1(seed), t2(seed), t3(seed), t4(seed), t5(seed), t6(seed) { }
+};
+
+// Every step depends on the last, so there is nothing to vectorize. Instead the 6105 variant is a separate
+// instantiation, the comparison is branch free and the words are loaded four at a time.
+template <bool Table>
+static ChecksumState run(u32 seed, const u8 *data) {
+    ChecksumState s(seed);
+
+    auto step = [&s, data](u32 offset, u32 d) {
+        u32 sum = s.t6 + d;
+        s.t4 += sum < s.t6;
+        s.t6 = sum;
+
+        s.t3 ^= d;
+
+        u32 amount = d & 0x1F;
+        u32 rotated = (d << amount) | (d >> ((32 - amount) & 0x1F));
+        s.t5 += rotated;
+
+        s.t2 ^= s.t2 > d ? rotated : s.t6 ^ d;
+
+        if (Table)
+            s.t1 += word(data + bootstrapTable + (offset & 0xFF)) ^ d;
+        else
+            s.t1 += s.t5 ^ d;
+    };
+
+    for (u32 offset = checksumStart; offset < checksumEnd; offset += 16) {
+        u32 d0 = word(data + offset);
+        u32 d1 = word(data + offset + 4);
+        u32 d2 = word(data + offset + 8);
+        u32 d3 = word(data + offset + 12);
+
+        step(offset, d0);
+        step(offset + 4, d1);
+        step(offset + 8, d2);
+        step(offset + 12, d3);
+    }
+
+    return s;
+}
+
+bool computeChecksum(Cic cic, const u8 *data, ssi size, u64 &out) {
+    if (cic == Cic::Unknown || size < checksumEnd)
+        return false;
+
+    ChecksumState s = cic == Cic::Cic6105 ? run<true>(seed(cic), data) : run<false>(seed(cic), data);
+
+    u32 first, second;
+
+    switch (cic) {
+        case Cic::Cic6103:
+            first = (s.t6 ^ s.t4) + s.t3;
+            second = (s.t5 ^ s.t2) + s.t1;
+            break;
+        case Cic::Cic6106:
+            first = s.t6 * s.t4 + s.t3;
+            second = s.t5 * s.t2 + s.t1;
+            break;
+        default:
+            first = s.t6 ^ s.t4 ^ s.t3;
+            second = s.t5 ^ s.t2 ^ s.t1;
+            break;
+    }
+
+    out = static_cast<u64>(first) << 32 | second;
+
+    return true;
+}
+
+ChecksumResult verifyChecksum(const u8 *data, ssi size) {
+    ChecksumResult result;
+
+    if (size < checksumStart)
+        return result;
+
+    result.cic = detectCic(data, size);
+
+    u64 stored;
+    std::memcpy(&stored, data + 0x10, sizeof(u64));
+    result.expected = swap(stored);
+
+    result.valid = computeChecksum(result.cic, data, size, result.actual) && result.actual == result.expected;
+
+    return result;
+}
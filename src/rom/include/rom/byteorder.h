@@ -0,0 +1,25 @@
+#pragma once
+
+#include <util/util.h>
+
+// How a dump stores the cartridge's big endian words, told apart by the first word of the header.
+enum class ByteOrder : u8 {
+    Big, // .z64, as the cartridge
+    Swapped, // .v64, bytes swapped in every half word
+    Little, // .n64, bytes reversed in every word
+    Unknown,
+};
+
+const char *getByteOrderName(ByteOrder order);
+ByteOrder detectByteOrder(const u8 *data, ssi size);
+
+// Reverses the bytes of every width (2 or 4) byte unit, using the widest vector unit the host has.
+// input may equal output, a trailing partial unit is copied unchanged.
+void swapBytes(u32 width, const u8 *input, u8 *output, ssi size);
+
+// Writes size bytes of an image in order as big endian, input may equal output.
+void toBigEndian(ByteOrder order, const u8 *input, u8 *output, ssi size);
+
+// Streams an unmodified image to path as big endian a chunk at a time, false if it can't be written.
+// Chunks are released from the mapping once written, so memory use doesn't grow with the image.
+bool writeBigEndian(ByteOrder order, const MappedFile &file, const std::string &path);
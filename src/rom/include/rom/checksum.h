@@ -0,0 +1,36 @@
+#pragma once
+
+#include <util/util.h>
+
+// Checksum chips, told apart by the bootstrap they shipped with. Each seeds the header checksum differently.
+enum class Cic : u8 {
+    Unknown,
+    Cic6101,
+    Cic6102, // also 7101
+    Cic6103, // also 7103
+    Cic6105, // also 7105
+    Cic6106, // also 7106
+    Cic7102,
+};
+
+const char *getCicName(Cic cic);
+
+// from the CRC32 of the bootstrap code, data must be big endian
+Cic detectCic(const u8 *data, ssi size);
+
+// The two words the header should hold at 0x10, computed over the first MiB after the bootstrap.
+// False for an unknown chip or an image too short to cover it.
+bool computeChecksum(Cic cic, const u8 *data, ssi size, u64 &out);
+
+class ChecksumResult {
+public:
+    Cic cic = Cic::Unknown;
+
+    u64 expected = 0; // from the header
+    u64 actual = 0;
+
+    // false as well when the checksum couldn't be computed
+    bool valid = false;
+};
+
+ChecksumResult verifyChecksum(const u8 *data, ssi size);
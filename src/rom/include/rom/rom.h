@@ -2,6 +2,8 @@
 
 #include <util/util.h>
 
+#include <rom/byteorder.h>
+
 class Header {
 public:
     Number<u32> magic; // might have register information
@@ -19,28 +21,24 @@ public:
     u32 bootstrap[1008];
 };
 
+// A cartridge image, either built in memory or a view of a mapped file that is never copied.
+// Images in another byte order are converted to big endian in place once, on construction.
 class Rom {
-public:
-    Header header;
-    std::vector<u8> data;
+    std::vector<u8> owned;
+    MappedFile mapped;
 
-    template <typename T>
-    static std::vector<u8> flipEndian(const std::vector<u8> &data) {
-        constexpr u32 unit = sizeof(T);
+    const u8 *bytes = nullptr;
+    ssi length = 0;
 
-        std::vector<u8> result(data.size());
-
-        assert(data.size() % unit == 0);
+public:
+    Header header;
 
-        for (uint32_t a = 0; a < data.size() / unit; a++) {
-            // retrive
-            T val = *reinterpret_cast<const T *>(&data[a * unit]);
-            // write
-            *reinterpret_cast<T *>(&result[a * unit]) = swap<u16>(val);
-        }
+    // as found, data() is big endian whatever this says unless it's Unknown
+    ByteOrder order = ByteOrder::Unknown;
 
-        return result;
-    }
+    const u8 *data() const { return bytes; }
+    ssi size() const { return length; }
 
     explicit Rom(std::vector<u8> data);
+    explicit Rom(MappedFile file);
 };
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include <rom/rom.h>
 
+#include <algorithm>
+
 //Header::Header(const u8 *data) {
 //    Scanner scanner(data);
 //
@@ -18,6 +20,18 @@
 //    scanner.pop(bootstrap, sizeof(bootstrap));
 //}
 
-Rom::Rom(std::vector<u8> data) : data(std::move(data)) {
-    header = *reinterpret_cast<Header *>(this->data.data());
+Rom::Rom(std::vector<u8> data) : owned(std::move(data)), bytes(owned.data()), length(owned.size()) {
+    order = detectByteOrder(owned.data(), owned.size());
+    toBigEndian(order, owned.data(), owned.data(), owned.size());
+
+    std::memcpy(&header, bytes, std::min(length, sizeof(Header)));
+}
+
+// Only the header is copied. A big endian image is read straight from the page cache when it's needed,
+// others become private pages as they are converted.
+Rom::Rom(MappedFile file) : mapped(std::move(file)), bytes(mapped.data()), length(mapped.size()) {
+    order = detectByteOrder(mapped.data(), mapped.size());
+    toBigEndian(order, mapped.data(), mapped.data(), mapped.size());
+
+    std::memcpy(&header, bytes, std::min(length, sizeof(Header)));
 }
\ No newline at end of file
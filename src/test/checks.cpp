@@ -0,0 +1,74 @@
+#include "test.h"
+
+#include <fmt/printf.h>
+
+bool Checks::expect(bool condition, const char *text, const char *file, i32 line) {
+    if (!condition)
+        fail(fmt::format("{} is false", text), file, line);
+
+    return condition;
+}
+
+void Checks::fail(const std::string &message, const char *file, i32 line) {
+    failures++;
+    fmt::print("  {}:{}: {}: {}\n", file, line, current, message);
+}
+
+bool Checks::report() const {
+    if (failed)
+        fmt::print("{} of {} tests failed, {} checks in all.\n", failed, tests, failures);
+    else
+        fmt::print("All {} tests passed.\n", tests);
+
+    return failed == 0;
+}
+
+void Image::put(u32 offset, u32 word) {
+    word = swap(word);
+    std::memcpy(&bytes[offset], &word, sizeof(u32));
+}
+
+void Image::boot(const std::vector<u32> &words) {
+    u32 offset = 0x40;
+
+    for (u32 word : words) {
+        put(offset, word);
+        offset += sizeof(u32);
+    }
+}
+
+Image::Image(ssi size) : bytes(size) {
+    // the usual first word, so byte order detection sees a big endian image
+    put(0, 0x80371240);
+}
+
+u32 special(u32 rs, u32 rt, u32 rd, u32 sa, u32 func) {
+    return rs << 21 | rt << 16 | rd << 11 | sa << 6 | func;
+}
+
+u32 immediate(u32 op, u32 rs, u32 rt, u16 value) {
+    return op << 26 | rs << 21 | rt << 16 | value;
+}
+
+u32 cop0(u32 rs, u32 rt, u32 rd) {
+    return 0b010000u << 26 | rs << 21 | rt << 16 | rd << 11;
+}
+
+Snapshot runProgram(const std::vector<u32> &words, const CpuSettings &settings) {
+    Image image;
+    image.boot(words);
+
+    Rom rom(image.bytes);
+    Cpu cpu(rom, settings);
+    cpu.exec();
+
+    return cpu.snapshot();
+}
+
+Snapshot runProgram(const std::vector<u32> &words, CpuEngine engine, u64 instructions) {
+    CpuSettings settings;
+    settings.engine = engine;
+    settings.limits.instructions = instructions;
+
+    return runProgram(words, settings);
+}
@@ -0,0 +1,62 @@
+#include "test.h"
+
+#include <algorithm>
+
+// Starts a PI DMA from the cart into RDRAM, polls PI_STATUS until it's done, reads back what arrived and
+// counts in s3 from then on, a loop that never counts as idle.
+static const std::vector<u32> pollProgram = {
+    immediate(0b001111, 0, 16, 0xA460), // lui s0, 0xA460
+    immediate(0b001111, 0, 9, 0x0010), // lui t1, 0x0010
+    immediate(0b101011, 16, 9, 0), // sw t1, PI_DRAM_ADDR(s0)
+    immediate(0b001111, 0, 9, 0x1000), // lui t1, 0x1000
+    immediate(0b101011, 16, 9, 4), // sw t1, PI_CART_ADDR(s0)
+    immediate(0b001001, 0, 9, 0x003F), // addiu t1, zero, 0x3F
+    immediate(0b101011, 16, 9, 12), // sw t1, PI_WR_LEN(s0)
+    immediate(0b100011, 16, 8, 16), // lw t0, PI_STATUS(s0)
+    immediate(0b001100, 8, 8, 3), // andi t0, t0, 3
+    immediate(0b000101, 8, 0, 0xFFFD), // bne t0, zero, -3
+    0, // nop
+    immediate(0b001001, 0, 17, 1), // addiu s1, zero, 1
+    immediate(0b001111, 0, 10, 0xA010), // lui t2, 0xA010
+    immediate(0b100011, 10, 18, 0), // lw s2, 0(t2)
+    immediate(0b001001, 19, 19, 1), // addiu s3, s3, 1
+    immediate(0b000100, 0, 0, 0xFFFE), // beq zero, zero, -2
+    0, // nop
+};
+
+void testIdle(Checks &checks) {
+    checks.run("idle/poll-device", [&checks]() {
+        CpuSettings settings;
+        settings.limits.instructions = 10000;
+
+        Snapshot skipped = runProgram(pollProgram, settings);
+
+        settings.idle.detect = false;
+        Snapshot stepped = runProgram(pollProgram, settings);
+
+        // the polling loop only waits on the DMA event, skipping it leaves more of the run for counting
+        CHECK(checks, skipped.idle.skips > 0);
+        CHECK_EQUAL(checks, stepped.idle.skips, 0ull);
+        CHECK(checks, skipped.registers.regs[19] > stepped.registers.regs[19]);
+
+        // and changes nothing else
+        for (u32 a = 0; a < 32; a++) {
+            if (a != 19 && skipped.registers.regs[a] != stepped.registers.regs[a])
+                checks.fail(fmt::format("r{} is {:#x} skipped, {:#x} stepped", a,
+                    skipped.registers.regs[a], stepped.registers.regs[a]), __FILE__, __LINE__);
+        }
+
+        CHECK_EQUAL(checks, skipped.registers.regs[17], 1ll);
+        CHECK_EQUAL(checks, static_cast<u32>(skipped.registers.regs[18]), 0x80371240u); // the first word of the image
+
+        CHECK_EQUAL(checks, skipped.memory.registers.size(), stepped.memory.registers.size());
+        CHECK(checks, skipped.memory.registers == stepped.memory.registers);
+
+        CHECK_EQUAL(checks, skipped.memory.pages.size(), stepped.memory.pages.size());
+
+        for (size_t a = 0; a < std::min(skipped.memory.pages.size(), stepped.memory.pages.size()); a++) {
+            if (*skipped.memory.pages[a] != *stepped.memory.pages[a])
+                checks.fail(fmt::format("state page {} differs from the stepped run", a), __FILE__, __LINE__);
+        }
+    });
+}
@@ -0,0 +1,69 @@
+#include "test.h"
+
+// Counts interrupts in s0, keeps Cause and EPC in s1 and s2, then quiets the timer and returns.
+static const u32 handler[] = {
+    immediate(0b001001, 16, 16, 1), // addiu s0, s0, 1
+    cop0(0b00000, 17, 13), // mfc0 s1, cause
+    cop0(0b00000, 18, 14), // mfc0 s2, epc
+    cop0(0b00100, 0, 11), // mtc0 zero, compare
+    0x42000018, // eret
+};
+
+// Copies the handler to the general exception vector, arms Compare, sets Status and spins counting in s3.
+static std::vector<u32> timerProgram(u16 status) {
+    std::vector<u32> words = {
+        immediate(0b001111, 0, 8, 0x8000), // lui t0, 0x8000
+    };
+
+    for (u32 a = 0; a < sizeof(handler) / sizeof(u32); a++) {
+        words.push_back(immediate(0b001111, 0, 9, static_cast<u16>(handler[a] >> 16))); // lui t1
+        words.push_back(immediate(0b001101, 9, 9, static_cast<u16>(handler[a]))); // ori t1, t1
+        words.push_back(immediate(0b101011, 8, 9, static_cast<u16>(0x180 + a * sizeof(u32)))); // sw t1, vector(t0)
+    }
+
+    std::vector<u32> tail = {
+        cop0(0b00100, 0, 9), // mtc0 zero, count
+        immediate(0b001001, 0, 10, 100), // addiu t2, zero, 100
+        cop0(0b00100, 10, 11), // mtc0 t2, compare
+        immediate(0b001101, 0, 11, status), // ori t3, zero, status
+        cop0(0b00100, 11, 12), // mtc0 t3, status
+        immediate(0b001001, 19, 19, 1), // addiu s3, s3, 1
+        immediate(0b000100, 0, 0, 0xFFFE), // beq zero, zero, -2
+        0, // nop
+    };
+
+    words.insert(words.end(), tail.begin(), tail.end());
+    return words;
+}
+
+void testInterrupts(Checks &checks) {
+    checks.run("interrupts/timer", [&checks]() {
+        // translated blocks end the same way, so both engines take it at the same boundary
+        for (CpuEngine engine : {CpuEngine::Interpreter, CpuEngine::Recompiler}) {
+            Snapshot state = runProgram(timerProgram(0x8001), engine, 5000);
+
+            CHECK_EQUAL(checks, state.registers.regs[16], 1ll);
+
+            // an interrupt with IP7 up, taken in the loop and returned from
+            u32 cause = static_cast<u32>(state.registers.regs[17]);
+            CHECK_EQUAL(checks, cause & Cop0::exceptionCode, 0u);
+            CHECK(checks, (cause & Cop0::timerInterrupt) != 0);
+
+            u32 epc = static_cast<u32>(state.registers.regs[18]);
+            u32 loop = 0xA4000040 + static_cast<u32>(timerProgram(0).size() - 3) * sizeof(u32);
+            CHECK(checks, epc >= loop && epc < loop + 3 * sizeof(u32));
+
+            CHECK_EQUAL(checks, state.cop0.regs[Cop0::status], 0x8001u);
+            CHECK(checks, state.registers.regs[19] > 1000);
+        }
+    });
+
+    checks.run("interrupts/masked", [&checks]() {
+        // IE without IM7, Cause still shows the timer but nothing is taken
+        Snapshot state = runProgram(timerProgram(0x0401), CpuEngine::Interpreter, 5000);
+
+        CHECK_EQUAL(checks, state.registers.regs[16], 0ll);
+        CHECK(checks, (state.cop0.regs[Cop0::cause] & Cop0::timerInterrupt) != 0);
+        CHECK_EQUAL(checks, state.cop0.regs[Cop0::status], 0x0401u);
+    });
+}
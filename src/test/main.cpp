@@ -0,0 +1,27 @@
+#include "test.h"
+
+#include <fmt/printf.h>
+
+#include <cstring>
+
+int main(int count, char **args) {
+    Checks checks;
+
+    for (i32 a = 1; a < count; a++) {
+        const char *arg = args[a];
+
+        if (strcmp(arg, "--filter") == 0 && a + 1 < count) {
+            checks.filter = args[++a];
+        } else {
+            fmt::print("Usage: scout_test [--filter <name>]\n");
+            return -1;
+        }
+    }
+
+    testMemory(checks);
+    testRecompiler(checks);
+    testInterrupts(checks);
+    testIdle(checks);
+
+    return checks.report() ? 0 : -1;
+}
@@ -0,0 +1,137 @@
+#include "test.h"
+
+#include <cpu/memory.h>
+
+void testMemory(Checks &checks) {
+    checks.run("memory/unmapped", [&checks]() {
+        Rom rom(Image().bytes);
+        Memory memory(rom);
+
+        // the 64DD, cart domain 2 and PIF ROM have nothing behind them yet
+        for (u32 address : {0xA5000000u, 0xA8000000u, 0xBFC00000u}) {
+            memory.set<u32>(address, 0x12345678);
+            memory.setByte(address + 5, 0x9A);
+
+            CHECK_EQUAL(checks, memory.get<u32>(address), 0u);
+            CHECK_EQUAL(checks, memory.get<u64>(address), 0ull);
+            CHECK_EQUAL(checks, memory.getByte(address + 5), 0);
+        }
+    });
+
+    checks.run("memory/cart", [&checks]() {
+        Image image(kb(12) + 2);
+        image.put(0x2000, 0xDEADBEEF);
+        image.bytes[0x3000] = 0x5A;
+
+        Rom rom(image.bytes);
+        Memory memory(rom);
+
+        CHECK_EQUAL(checks, memory.get<u32>(0xB0002000), 0xDEADBEEFu);
+        CHECK_EQUAL(checks, memory.get<u32>(0x90002000), 0xDEADBEEFu);
+        CHECK_EQUAL(checks, memory.getByte(0xB0003000), 0x5A);
+
+        // the last page is only partly covered, past the image reads as zero
+        CHECK_EQUAL(checks, memory.getByte(0xB0003002), 0);
+        CHECK_EQUAL(checks, memory.get<u32>(0xB0003000), 0x5A000000u);
+
+        // read only
+        memory.set<u32>(0xB0002000, 0);
+        CHECK_EQUAL(checks, memory.get<u32>(0xB0002000), 0xDEADBEEFu);
+    });
+
+    checks.run("memory/pif", [&checks]() {
+        Rom rom(Image().bytes);
+        Memory memory(rom);
+
+        memory.set<u32>(0xBFC007FC, 0x00000008);
+        memory.setByte(0xBFC007C0, 0xFF);
+
+        CHECK_EQUAL(checks, memory.get<u32>(0xBFC007FC), 8u);
+        CHECK_EQUAL(checks, memory.getByte(0x9FC007C0), 0xFF);
+    });
+
+    checks.run("memory/signal-queue", [&checks]() {
+        Rom rom(Image().bytes);
+        Memory memory(rom);
+
+        // transfers stay in flight until completed by hand
+        memory.transfer = [](Device, u64 duration) { return duration; };
+
+        memory.set<u32>(0xA0001000, 0x11111111);
+        memory.set<u32>(0xA0002000, 0x22222222);
+
+        // RDRAM to DMEM, eight bytes each
+        memory.set<u32>(0xA4040000, 0x000);
+        memory.set<u32>(0xA4040004, 0x1000);
+        memory.set<u32>(0xA4040008, 7);
+
+        memory.set<u32>(0xA4040000, 0x008);
+        memory.set<u32>(0xA4040004, 0x2000);
+        memory.set<u32>(0xA4040008, 7);
+
+        CHECK_EQUAL(checks, memory.get<u32>(0xA4040014), 1u); // full
+        CHECK_EQUAL(checks, memory.get<u32>(0xA4040018), 1u); // busy
+        CHECK_EQUAL(checks, memory.get<u32>(0xA4000000), 0x11111111u);
+        CHECK_EQUAL(checks, memory.get<u32>(0xA4000008), 0u);
+
+        // the queued transfer sees RDRAM as it is when it starts, not when it was queued
+        memory.set<u32>(0xA0002000, 0x33333333);
+        memory.completeTransfer(Device::Signal);
+
+        CHECK_EQUAL(checks, memory.get<u32>(0xA4040014), 0u);
+        CHECK_EQUAL(checks, memory.get<u32>(0xA4040018), 1u);
+        CHECK_EQUAL(checks, memory.get<u32>(0xA4000008), 0x33333333u);
+        CHECK_EQUAL(checks, memory.get<u32>(0xA4040000), 0x010u);
+
+        memory.completeTransfer(Device::Signal);
+
+        CHECK_EQUAL(checks, memory.get<u32>(0xA4040018), 0u);
+        CHECK_EQUAL(checks, memory.transferEnd(Device::Signal), 0ull);
+    });
+
+    checks.run("memory/state", [&checks]() {
+        Rom rom(Image().bytes);
+        Memory memory(rom);
+
+        memory.set<u32>(0xA4600000, 0x00123456); // PI DRAM address
+        memory.set<u32>(0xA4040000, 0x00000ABC); // SP memory address
+
+        MemoryState state = memory.capture();
+        CHECK_EQUAL(checks, state.registers.size(), Memory::registerBytes());
+
+        // the MI version register leads, least significant byte first
+        CHECK_EQUAL(checks, state.registers[4], 0x02);
+        CHECK_EQUAL(checks, state.registers[7], 0x02);
+
+        memory.set<u32>(0xA4600000, 0);
+        memory.set<u32>(0xA4040000, 0);
+        memory.restore(state);
+
+        CHECK_EQUAL(checks, memory.get<u32>(0xA4600000), 0x00123456u);
+        CHECK_EQUAL(checks, memory.get<u32>(0xA4040000), 0x00000ABCu);
+    });
+
+    checks.run("memory/page-crossing", [&checks]() {
+        Rom rom(Image().bytes);
+        Memory memory(rom);
+
+        std::vector<u32> written;
+        memory.watcher = [&written](u32 page) { written.push_back(page); };
+
+        u32 page = 0x00101000 >> Memory::pageBits;
+
+        memory.set<u32>(0x80101000, 0x11223344);
+        MemoryState state = memory.capture();
+
+        // the second half of the word lands on the next page, which has to be let go as well
+        memory.watch(page);
+        memory.set<u32>(0x80100FFE, 0xAABBCCDD);
+
+        CHECK_EQUAL(checks, memory.get<u32>(0x80101000), 0xCCDD3344u);
+        CHECK_EQUAL(checks, written.size(), static_cast<size_t>(1));
+        CHECK(checks, !written.empty() && written[0] == page);
+
+        memory.restore(state);
+        CHECK_EQUAL(checks, memory.get<u32>(0x80101000), 0x11223344u);
+    });
+}
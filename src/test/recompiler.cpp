@@ -0,0 +1,159 @@
+#include "test.h"
+
+#include <cpu/recompiler.h>
+
+#include <algorithm>
+
+static bool samePage(const std::shared_ptr<const PageData> &a, const std::shared_ptr<const PageData> &b) {
+    static const PageData zero = {};
+    return (a ? *a : zero) == (b ? *b : zero);
+}
+
+// the same program under both engines has to leave the same registers and memory behind
+static Snapshot compareEngines(Checks &checks, const std::vector<u32> &words) {
+    Snapshot interpreted = runProgram(words, CpuEngine::Interpreter);
+    Snapshot translated = runProgram(words, CpuEngine::Recompiler);
+
+    for (u32 a = 0; a < 32; a++) {
+        if (translated.registers.regs[a] != interpreted.registers.regs[a])
+            checks.fail(fmt::format("r{} is {:#x}, the interpreter has {:#x}", a,
+                translated.registers.regs[a], interpreted.registers.regs[a]), __FILE__, __LINE__);
+    }
+
+    CHECK_EQUAL(checks, translated.registers.hi, interpreted.registers.hi);
+    CHECK_EQUAL(checks, translated.registers.lo, interpreted.registers.lo);
+    CHECK_EQUAL(checks, translated.registers.pc, interpreted.registers.pc);
+
+    CHECK_EQUAL(checks, translated.memory.pages.size(), interpreted.memory.pages.size());
+
+    for (size_t a = 0; a < std::min(translated.memory.pages.size(), interpreted.memory.pages.size()); a++) {
+        if (!samePage(translated.memory.pages[a], interpreted.memory.pages[a]))
+            checks.fail(fmt::format("state page {} differs from the interpreter", a), __FILE__, __LINE__);
+    }
+
+    return translated;
+}
+
+void testRecompiler(Checks &checks) {
+    if (!Recompiler::supported()) {
+        fmt::print("recompiler/* skipped, no recompiler for this host\n");
+        return;
+    }
+
+    checks.run("recompiler/alu", [&checks]() {
+        Snapshot state = compareEngines(checks, {
+            immediate(0b001111, 0, 8, 0x1234), // lui t0, 0x1234
+            immediate(0b001101, 8, 8, 0x5678), // ori t0, t0, 0x5678
+            immediate(0b001001, 0, 9, 0xFFFD), // addiu t1, zero, -3
+            special(8, 9, 10, 0, 0b100001), // addu t2, t0, t1
+            special(9, 8, 11, 0, 0b100011), // subu t3, t1, t0
+            special(8, 9, 16, 0, 0b100100), // and s0, t0, t1
+            special(8, 9, 17, 0, 0b100101), // or s1, t0, t1
+            special(8, 9, 18, 0, 0b100110), // xor s2, t0, t1
+            special(8, 9, 2, 0, 0b100111), // nor v0, t0, t1
+            special(9, 8, 3, 0, 0b101010), // slt v1, t1, t0
+            special(9, 8, 4, 0, 0b101011), // sltu a0, t1, t0
+            special(0, 8, 5, 4, 0b000000), // sll a1, t0, 4
+            special(0, 9, 6, 3, 0b000010), // srl a2, t1, 3
+            special(9, 8, 12, 0, 0b000100), // sllv t4, t0, t1
+            special(8, 9, 0, 0, 0b011000), // mult t0, t1
+            special(0, 0, 13, 0, 0b010010), // mflo t5
+            special(0, 0, 14, 0, 0b010000), // mfhi t6
+            immediate(0b001010, 9, 19, 5), // slti s3, t1, 5
+            immediate(0b001011, 9, 20, 5), // sltiu s4, t1, 5
+            immediate(0b001100, 9, 21, 0x0FF0), // andi s5, t1, 0xFF0
+            immediate(0b001110, 8, 22, 0xFFFF), // xori s6, t0, 0xFFFF
+            special(8, 9, 0, 0, 0b100001), // addu zero, t0, t1
+            special(0, 8, 23, 0, 0b100001), // addu s7, zero, t0
+            park, 0,
+        });
+
+        CHECK_EQUAL(checks, state.registers.regs[10], 0x12345675ll);
+        CHECK_EQUAL(checks, state.registers.regs[0], 0ll);
+        CHECK_EQUAL(checks, state.registers.regs[23], 0x12345678ll);
+    });
+
+    checks.run("recompiler/memory", [&checks]() {
+        Snapshot state = compareEngines(checks, {
+            immediate(0b001111, 0, 16, 0x8010), // lui s0, 0x8010
+            immediate(0b001111, 0, 8, 0x89AB), // lui t0, 0x89AB
+            immediate(0b001101, 8, 8, 0xCDEF), // ori t0, t0, 0xCDEF
+            immediate(0b101011, 16, 8, 0), // sw t0, 0(s0)
+            immediate(0b101001, 16, 8, 4), // sh t0, 4(s0)
+            immediate(0b101000, 16, 8, 7), // sb t0, 7(s0)
+            immediate(0b101011, 16, 8, 8), // sw t0, 8(s0)
+            immediate(0b100011, 16, 9, 0), // lw t1, 0(s0)
+            immediate(0b100001, 16, 10, 4), // lh t2, 4(s0)
+            immediate(0b100101, 16, 11, 4), // lhu t3, 4(s0)
+            immediate(0b100000, 16, 17, 7), // lb s1, 7(s0)
+            immediate(0b100100, 16, 18, 7), // lbu s2, 7(s0)
+            immediate(0b100011, 16, 19, 8), // lw s3, 8(s0)
+            immediate(0b001001, 19, 19, 1), // addiu s3, s3, 1
+            immediate(0b101011, 16, 19, 12), // sw s3, 12(s0)
+            immediate(0b100011, 16, 0, 12), // lw zero, 12(s0)
+            park, 0,
+        });
+
+        CHECK_EQUAL(checks, state.registers.regs[11], 0xCDEFll);
+        CHECK_EQUAL(checks, state.registers.regs[18], 0xEFll);
+        CHECK_EQUAL(checks, state.registers.regs[0], 0ll);
+    });
+
+    checks.run("recompiler/likely", [&checks]() {
+        Snapshot state = compareEngines(checks, {
+            immediate(0b001001, 0, 8, 1), // addiu t0, zero, 1
+            immediate(0b010100, 8, 0, 2), // beql t0, zero, +2, not taken
+            immediate(0b001001, 0, 9, 5), // addiu t1, zero, 5, nullified
+            immediate(0b001001, 0, 10, 7), // addiu t2, zero, 7
+            immediate(0b010101, 8, 0, 2), // bnel t0, zero, +2, taken
+            immediate(0b001001, 0, 11, 9), // addiu t3, zero, 9
+            immediate(0b001001, 0, 16, 11), // addiu s0, zero, 11, skipped
+            immediate(0b010110, 8, 0, 2), // blezl t0, +2, not taken
+            immediate(0b001001, 0, 17, 13), // addiu s1, zero, 13, nullified
+            immediate(0b010111, 8, 0, 2), // bgtzl t0, +2, taken
+            immediate(0b001001, 0, 18, 15), // addiu s2, zero, 15
+            immediate(0b001001, 0, 19, 17), // addiu s3, zero, 17, skipped
+            immediate(0b010100, 0, 0, 2), // beql zero, zero, +2, taken
+            immediate(0b001001, 0, 20, 19), // addiu s4, zero, 19
+            immediate(0b001001, 0, 21, 21), // addiu s5, zero, 21, skipped
+            park, 0,
+        });
+
+        CHECK_EQUAL(checks, state.registers.regs[9], 0ll);
+        CHECK_EQUAL(checks, state.registers.regs[10], 7ll);
+        CHECK_EQUAL(checks, state.registers.regs[11], 9ll);
+        CHECK_EQUAL(checks, state.registers.regs[16], 0ll);
+        CHECK_EQUAL(checks, state.registers.regs[17], 0ll);
+        CHECK_EQUAL(checks, state.registers.regs[18], 15ll);
+        CHECK_EQUAL(checks, state.registers.regs[19], 0ll);
+        CHECK_EQUAL(checks, state.registers.regs[20], 19ll);
+        CHECK_EQUAL(checks, state.registers.regs[21], 0ll);
+    });
+
+    checks.run("recompiler/count", [&checks]() {
+        std::vector<u32> words = {
+            cop0(0b00100, 0, 9), // mtc0 zero, count
+        };
+
+        // handlers in the middle of a block see the time they run at, not when the block was entered
+        words.insert(words.end(), 20, 0);
+
+        std::vector<u32> tail = {
+            cop0(0b00000, 8, 9), // mfc0 t0, count
+            immediate(0b001001, 0, 9, 1), // addiu t1, zero, 1
+            immediate(0b001001, 9, 9, 1), // addiu t1, t1, 1
+            immediate(0b010100, 9, 0, 2), // beql t1, zero, +2, not taken
+            immediate(0b001001, 0, 10, 5), // addiu t2, zero, 5, nullified and not charged
+            cop0(0b00000, 11, 9), // mfc0 t3, count
+            park, 0,
+        };
+
+        words.insert(words.end(), tail.begin(), tail.end());
+
+        Snapshot state = compareEngines(checks, words);
+
+        CHECK_EQUAL(checks, state.registers.regs[8], 10ll);
+        CHECK_EQUAL(checks, state.registers.regs[10], 0ll);
+        CHECK_EQUAL(checks, state.registers.regs[11], 12ll);
+    });
+}
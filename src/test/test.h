@@ -0,0 +1,85 @@
+#pragma once
+
+#include <util/util.h>
+#include <cpu/snapshot.h>
+
+#include <fmt/format.h>
+
+#include <string>
+
+// Runs named tests and counts the checks that failed in them, printing each one where it happened.
+class Checks {
+    std::string current;
+
+    u32 tests = 0;
+    u32 failed = 0;
+    u32 failures = 0;
+
+public:
+    // only tests whose name contains this run
+    std::string filter;
+
+    template <typename Body>
+    void run(const std::string &name, Body body) {
+        if (name.find(filter) == std::string::npos)
+            return;
+
+        current = name;
+        u32 before = failures;
+
+        tests++;
+        body();
+
+        if (failures != before)
+            failed++;
+
+        fmt::print("{:<40} {}\n", name, failures == before ? "ok" : "FAILED");
+    }
+
+    bool expect(bool condition, const char *text, const char *file, i32 line);
+
+    template <typename A, typename B>
+    bool equal(const A &actual, const B &expected, const char *text, const char *file, i32 line) {
+        if (actual == expected)
+            return true;
+
+        fail(fmt::format("{} is 0x{:x}, expected 0x{:x}", text, actual, expected), file, line);
+        return false;
+    }
+
+    void fail(const std::string &message, const char *file, i32 line);
+
+    // prints the totals, true if every check passed
+    bool report() const;
+};
+
+#define CHECK(checks, condition) (checks).expect((condition), #condition, __FILE__, __LINE__)
+#define CHECK_EQUAL(checks, actual, expected) (checks).equal((actual), (expected), #actual, __FILE__, __LINE__)
+
+// A header sized image with code placed in the bootstrap, which the cpu starts at 0xA4000040.
+class Image {
+public:
+    std::vector<u8> bytes;
+
+    void put(u32 offset, u32 word);
+    // code from offset 0x40 on, one word after another
+    void boot(const std::vector<u32> &words);
+
+    explicit Image(ssi size = kb(4));
+};
+
+// instruction words for test programs
+u32 special(u32 rs, u32 rt, u32 rd, u32 sa, u32 func);
+u32 immediate(u32 op, u32 rs, u32 rt, u16 value);
+u32 cop0(u32 rs, u32 rt, u32 rd);
+// branches back onto itself, where a program parks once it's done
+constexpr u32 park = 0b000100u << 26 | 0xFFFF;
+
+// Boots words on a fresh machine and runs them until the settings' limits.
+Snapshot runProgram(const std::vector<u32> &words, const CpuSettings &settings);
+Snapshot runProgram(const std::vector<u32> &words, CpuEngine engine, u64 instructions = 1000);
+
+void testMemory(Checks &checks);
+void testRecompiler(Checks &checks);
+void testInterrupts(Checks &checks);
+void testIdle(Checks &checks);
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <util/util.h>
+
+// Warnings about behaviour the emulator doesn't model. They are counted per address or per instruction,
+// printed by a background thread with repeats and floods held back, and totalled by printLogSummary.
+enum class LogKind : u8 {
+    Read,
+    Write,
+    Instruction,
+};
+
+// What the hot path hands over, name has to be a string literal.
+class LogRecord {
+public:
+    LogKind kind = LogKind::Read;
+    u8 value = 0; // written byte
+    u32 address = 0; // or instruction word
+    u32 count = 1;
+    const char *name = nullptr;
+};
+
+// Counts the record on this thread, it's only passed on to the writer once something else turns up.
+void logUnimplemented(LogKind kind, u32 address, u8 value = 0, const char *name = nullptr);
+
+// Stops the writer and prints every distinct record by count, nothing when there were none.
+void printLogSummary();
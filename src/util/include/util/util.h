@@ -2,6 +2,9 @@
 
 #include <string>
 #include <vector>
+#include <cstring>
+#include <cassert>
+#include <cstdint>
 
 typedef uint8_t u8;
 typedef uint16_t u16;
@@ -23,7 +26,43 @@ constexpr ssi mb(ssi value) { return kb(value) * 1024; }
 constexpr ssi gb(ssi value) { return mb(value) * 1024; }
 
 std::vector<u8> loadFile(const std::string &path);
-void writeFile(const std::string &path, const std::vector<u8> &data);
+// false if the file couldn't be opened or written in full
+bool writeFile(const std::string &path, const std::vector<u8> &data);
+
+// A whole file mapped copy on write. Pages are shared with the page cache, and every other process mapping
+// the same file, until they are written. Writes never reach the file.
+class MappedFile {
+    u8 *address = nullptr;
+    ssi length = 0;
+
+public:
+    u8 *data() { return address; }
+    const u8 *data() const { return address; }
+    ssi size() const { return length; }
+
+    // also true when the file couldn't be opened
+    bool empty() const { return length == 0; }
+
+    // Asks the kernel to read the whole file in now, and to back it with huge pages where it can.
+    void prefetch() const;
+    // Drops pages this process has read from its resident set, they stay in the page cache.
+    // Anything written to them is lost, so only for pages that never were.
+    void release(ssi offset, ssi size) const;
+
+    MappedFile() = default;
+    explicit MappedFile(const std::string &path);
+    ~MappedFile();
+
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+};
+
+// PackBits run length coding, appends to out. Unpacking fails unless input decodes to exactly size bytes.
+void packBits(const u8 *input, ssi size, std::vector<u8> &out);
+bool unpackBits(const u8 *input, ssi length, u8 *out, ssi size);
 
 template <typename T>
 T swap(T input) {
@@ -40,6 +79,26 @@ T swap(T input) {
     return result;
 }
 
+template <>
+inline u8 swap(u8 input) {
+    return input;
+}
+
+template <>
+inline u16 swap(u16 input) {
+    return __builtin_bswap16(input);
+}
+
+template <>
+inline u32 swap(u32 input) {
+    return __builtin_bswap32(input);
+}
+
+template <>
+inline u64 swap(u64 input) {
+    return __builtin_bswap64(input);
+}
+
 template <typename T>
 T shift(T input, u32 start, u32 count) {
     constexpr T mask = ~T(0);
@@ -51,11 +110,11 @@ template <typename T>
 class Number {
     T value = 0;
 public:
-    T get() {
+    T get() const {
         return swap(value);
     }
 
-    operator T() {
+    operator T() const {
         return get();
     }
 
@@ -0,0 +1,300 @@
+#include <util/log.h>
+
+#include <fmt/printf.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+// Bounded queue with many producers and the writer as its only consumer. Each cell's sequence says
+// whose turn it is, so producers only ever race on head.
+class LogQueue {
+    static constexpr u64 capacity = 1 << 16;
+
+    class Cell {
+    public:
+        std::atomic<u64> sequence;
+        LogRecord record;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+
+    alignas(64) std::atomic<u64> head;
+    alignas(64) u64 tail = 0;
+
+public:
+    bool push(const LogRecord &record) {
+        u64 position = head.load(std::memory_order_relaxed);
+
+        while (true) {
+            Cell &cell = cells[position & (capacity - 1)];
+            i64 difference = static_cast<i64>(cell.sequence.load(std::memory_order_acquire) - position);
+
+            if (difference == 0) {
+                if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    cell.record = record;
+                    cell.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (difference < 0) {
+                return false;
+            } else {
+                position = head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool pop(LogRecord &record) {
+        Cell &cell = cells[tail & (capacity - 1)];
+
+        if (cell.sequence.load(std::memory_order_acquire) != tail + 1)
+            return false;
+
+        record = cell.record;
+        cell.sequence.store(tail + capacity, std::memory_order_release);
+        tail++;
+
+        return true;
+    }
+
+    LogQueue() : cells(new Cell[capacity]), head(0) {
+        for (u64 a = 0; a < capacity; a++)
+            cells[a].sequence.store(a, std::memory_order_relaxed);
+    }
+};
+
+class LogEntry {
+public:
+    LogRecord first;
+    u64 count = 0;
+
+    // the next total worth mentioning, every power of ten
+    u64 report = 10;
+};
+
+class LogWriter {
+    static constexpr u32 linesPerSecond = 100;
+
+    std::unordered_map<u64, LogEntry> entries;
+
+    u32 lines = 0;
+    u64 suppressed = 0;
+    std::chrono::steady_clock::time_point window;
+
+    static u64 key(const LogRecord &record);
+    static std::string describe(const LogRecord &record);
+
+    void print(const LogRecord &record, const std::string &suffix);
+
+public:
+    LogQueue queue;
+    std::atomic<u64> dropped;
+
+    std::atomic<bool> running;
+    std::thread thread;
+    std::once_flag started;
+
+    void take(const LogRecord &record);
+    void drain();
+    void loop();
+
+    void summary();
+
+    LogWriter() : dropped(0), running(false) { }
+
+    // without a summary whatever is still queued is lost
+    ~LogWriter() {
+        running = false;
+
+        if (thread.joinable())
+            thread.join();
+    }
+};
+
+static LogWriter &writer() {
+    static LogWriter instance;
+    return instance;
+}
+
+// Repeats of a record stay here, a polling loop only reaches the queue once per 2^16 reads.
+// Direct mapped on the low address bits, so the bytes of one word access don't evict each other.
+class LogCache {
+    static constexpr u32 size = 8;
+    static constexpr u32 limit = 1 << 16;
+
+    // count is the repeats not sent yet, identity stays valid while filled
+    LogRecord slots[size];
+    bool filled[size] = {};
+
+public:
+    void add(const LogRecord &record);
+    void flush();
+
+    ~LogCache() { flush(); }
+};
+
+static thread_local LogCache cache;
+
+static void send(const LogRecord &record) {
+    LogWriter &log = writer();
+
+    std::call_once(log.started, [&log]() {
+        log.running = true;
+        log.thread = std::thread(&LogWriter::loop, &log);
+    });
+
+    if (!log.queue.push(record))
+        log.dropped += record.count;
+}
+
+void LogCache::add(const LogRecord &record) {
+    u32 index = record.address % size;
+    LogRecord &slot = slots[index];
+
+    if (filled[index] && slot.kind == record.kind && slot.address == record.address && slot.name == record.name) {
+        if (++slot.count == limit) {
+            send(slot);
+            slot.count = 0;
+        }
+
+        return;
+    }
+
+    if (filled[index] && slot.count)
+        send(slot);
+
+    // the first one goes out right away so it's printed while it's still relevant
+    send(record);
+
+    slot = record;
+    slot.count = 0;
+    filled[index] = true;
+}
+
+void LogCache::flush() {
+    for (u32 a = 0; a < size; a++) {
+        if (filled[a] && slots[a].count)
+            send(slots[a]);
+
+        slots[a].count = 0;
+    }
+}
+
+u64 LogWriter::key(const LogRecord &record) {
+    // instructions by what's missing, accesses by address
+    u64 identity = record.kind == LogKind::Instruction ? reinterpret_cast<uintptr_t>(record.name) : record.address;
+
+    return identity << 2 | static_cast<u8>(record.kind);
+}
+
+std::string LogWriter::describe(const LogRecord &record) {
+    switch (record.kind) {
+        case LogKind::Read:
+            return fmt::format("Unimplemented GET 0x{:0>8x}", record.address);
+        case LogKind::Write:
+            return fmt::format("Unimplemented SET 0x{:0>8x} = 0x{:0>2x}", record.address, record.value);
+        default:
+            return fmt::format("Unimplemented {} instruction: 0b{:0>32b}", record.name, record.address);
+    }
+}
+
+void LogWriter::print(const LogRecord &record, const std::string &suffix) {
+    auto now = std::chrono::steady_clock::now();
+
+    if (now - window >= std::chrono::seconds(1)) {
+        window = now;
+        lines = 0;
+    }
+
+    if (lines >= linesPerSecond) {
+        suppressed++;
+        return;
+    }
+
+    lines++;
+    fmt::print("{}{}\n", describe(record), suffix);
+}
+
+void LogWriter::take(const LogRecord &record) {
+    LogEntry &entry = entries[key(record)];
+
+    u64 before = entry.count;
+    entry.count += record.count;
+
+    if (!before) {
+        entry.first = record;
+        print(record, "");
+    } else if (entry.count >= entry.report) {
+        while (entry.report <= entry.count)
+            entry.report *= 10;
+
+        print(record, fmt::format(" (seen {} times)", entry.count));
+    }
+}
+
+void LogWriter::drain() {
+    LogRecord record;
+
+    while (queue.pop(record))
+        take(record);
+}
+
+void LogWriter::loop() {
+    while (running.load()) {
+        drain();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    drain();
+}
+
+void LogWriter::summary() {
+    if (thread.joinable()) {
+        running = false;
+        thread.join();
+    }
+
+    // threads still running may have pushed more since
+    drain();
+
+    if (entries.empty())
+        return;
+
+    std::vector<const LogEntry *> sorted;
+    for (const auto &entry : entries)
+        sorted.push_back(&entry.second);
+
+    std::sort(sorted.begin(), sorted.end(), [](const LogEntry *a, const LogEntry *b) { return a->count > b->count; });
+
+    fmt::print("\nUnimplemented, {} distinct\n{:>14}  {}\n", sorted.size(), "count", "first seen");
+
+    for (const LogEntry *entry : sorted)
+        fmt::print("{:>14}  {}\n", entry->count, describe(entry->first));
+
+    if (suppressed)
+        fmt::print("{} lines held back by the rate limit.\n", suppressed);
+    if (dropped)
+        fmt::print("{} records dropped with the queue full.\n", dropped.load());
+
+    entries.clear();
+    suppressed = 0;
+    dropped = 0;
+}
+
+void logUnimplemented(LogKind kind, u32 address, u8 value, const char *name) {
+    LogRecord record;
+    record.kind = kind;
+    record.address = address;
+    record.value = value;
+    record.name = name;
+
+    cache.add(record);
+}
+
+void printLogSummary() {
+    cache.flush();
+    writer().summary();
+}
@@ -1,6 +1,13 @@
 #include <util/util.h>
 
+#include <algorithm>
 #include <fstream>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 std::vector<u8> loadFile(const std::string &path) {
     std::ifstream stream(path, std::ios::ate | std::ios::binary);
@@ -16,14 +23,134 @@ std::vector<u8> loadFile(const std::string &path) {
     return data;
 }
 
-void writeFile(const std::string &path, const std::vector<u8> &data) {
+bool writeFile(const std::string &path, const std::vector<u8> &data) {
     std::ofstream stream(path, std::ios::trunc | std::ios::binary);
 
-    assert(stream.is_open());
+    if (!stream.is_open())
+        return false;
 
     stream.write(reinterpret_cast<const char *>(data.data()), data.size());
-
     stream.close();
+
+    return !stream.fail();
+}
+
+MappedFile::MappedFile(const std::string &path) {
+    int file = open(path.c_str(), O_RDONLY);
+
+    if (file < 0)
+        return;
+
+    struct stat info = {};
+
+    if (fstat(file, &info) == 0 && info.st_size > 0) {
+        void *mapping = mmap(nullptr, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+
+        if (mapping != MAP_FAILED) {
+            address = static_cast<u8 *>(mapping);
+            length = info.st_size;
+        }
+    }
+
+    // the mapping keeps the file alive
+    close(file);
+}
+
+MappedFile::~MappedFile() {
+    if (address)
+        munmap(address, length);
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+    : address(std::exchange(other.address, nullptr)), length(std::exchange(other.length, 0)) { }
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+    std::swap(address, other.address);
+    std::swap(length, other.length);
+
+    return *this;
+}
+
+void MappedFile::prefetch() const {
+    if (!address)
+        return;
+
+    madvise(address, length, MADV_WILLNEED);
+#ifdef MADV_HUGEPAGE
+    // only honoured for files on kernels with read only THP for page cache, harmless elsewhere
+    madvise(address, length, MADV_HUGEPAGE);
+#endif
+}
+
+void MappedFile::release(ssi offset, ssi size) const {
+    static const ssi page = sysconf(_SC_PAGESIZE);
+
+    // whole pages inside the range only
+    ssi start = (offset + page - 1) / page * page;
+    ssi end = std::min(offset + size, length) / page * page;
+
+    if (address && start < end)
+        madvise(address + start, end - start, MADV_DONTNEED);
+}
+
+// A header n >= 0 is followed by n + 1 literal bytes, n < 0 by one byte repeated 1 - n times.
+void packBits(const u8 *input, ssi size, std::vector<u8> &out) {
+    ssi a = 0;
+
+    while (a < size) {
+        ssi run = 1;
+        while (a + run < size && run < 128 && input[a + run] == input[a])
+            run++;
+
+        if (run >= 3) {
+            out.push_back(static_cast<u8>(1 - static_cast<i32>(run)));
+            out.push_back(input[a]);
+            a += run;
+            continue;
+        }
+
+        ssi start = a;
+        while (a < size && a - start < 128
+            && !(a + 2 < size && input[a] == input[a + 1] && input[a] == input[a + 2]))
+            a++;
+
+        out.push_back(static_cast<u8>(a - start - 1));
+        out.insert(out.end(), input + start, input + a);
+    }
+}
+
+bool unpackBits(const u8 *input, ssi length, u8 *out, ssi size) {
+    const u8 *end = input + length;
+    ssi a = 0;
+
+    while (a < size) {
+        if (input == end)
+            return false;
+
+        i8 header = static_cast<i8>(*input++);
+
+        if (header == -128)
+            return false;
+
+        if (header >= 0) {
+            ssi count = header + 1;
+            if (a + count > size || static_cast<ssi>(end - input) < count)
+                return false;
+
+            std::memcpy(out + a, input, count);
+            input += count;
+            a += count;
+        } else {
+            ssi count = 1 - header;
+            if (a + count > size || input == end)
+                return false;
+
+            std::memset(out + a, *input++, count);
+            a += count;
+        }
+    }
+
+    return input == end;
 }
 
 Scanner::Scanner(const u8 *data) : data(data) { }